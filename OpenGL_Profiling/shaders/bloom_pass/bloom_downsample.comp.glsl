@@ -0,0 +1,90 @@
+#version 460
+
+// 13 tap downsample from "Next Generation Post Processing in Call of Duty: Advanced Warfare" (Jimenez 2014)
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uSourceTexture; // Must be linearly filtered
+uniform int uSourceLevel;
+
+// Only for the first downsample, stops single bright pixels (fireflies) from flickering
+uniform bool uKarisAverage;
+
+layout (rgba16f, binding = 0) uniform writeonly image2D uOutputImage;
+
+float karisWeight(vec3 colour)
+{
+    return 1.0 / (1.0 + dot(colour, vec3(0.2126, 0.7152, 0.0722)));
+}
+
+vec3 sampleSource(vec2 uv, vec2 texelSize, vec2 offset)
+{
+    return textureLod(uSourceTexture, uv + offset * texelSize, float(uSourceLevel)).rgb;
+}
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const ivec2 outputSize = imageSize(uOutputImage);
+
+    if (any(greaterThanEqual(texel, outputSize))) return;
+
+    const vec2 uv = (vec2(texel) + 0.5) / vec2(outputSize);
+    const vec2 texelSize = 1.0 / vec2(textureSize(uSourceTexture, uSourceLevel));
+
+    // a - b - c
+    // - j - k -
+    // d - e - f
+    // - l - m -
+    // g - h - i
+    const vec3 a = sampleSource(uv, texelSize, vec2(-2.0,  2.0));
+    const vec3 b = sampleSource(uv, texelSize, vec2( 0.0,  2.0));
+    const vec3 c = sampleSource(uv, texelSize, vec2( 2.0,  2.0));
+    const vec3 d = sampleSource(uv, texelSize, vec2(-2.0,  0.0));
+    const vec3 e = sampleSource(uv, texelSize, vec2( 0.0,  0.0));
+    const vec3 f = sampleSource(uv, texelSize, vec2( 2.0,  0.0));
+    const vec3 g = sampleSource(uv, texelSize, vec2(-2.0, -2.0));
+    const vec3 h = sampleSource(uv, texelSize, vec2( 0.0, -2.0));
+    const vec3 i = sampleSource(uv, texelSize, vec2( 2.0, -2.0));
+    const vec3 j = sampleSource(uv, texelSize, vec2(-1.0,  1.0));
+    const vec3 k = sampleSource(uv, texelSize, vec2( 1.0,  1.0));
+    const vec3 l = sampleSource(uv, texelSize, vec2(-1.0, -1.0));
+    const vec3 m = sampleSource(uv, texelSize, vec2( 1.0, -1.0));
+
+    vec3 result;
+
+    if (uKarisAverage)
+    {
+        // Five overlapping 2x2 boxes, each weighted by its own brightness
+        const vec3 boxes[5] = vec3[](
+            (a + b + d + e) * 0.25,
+            (b + c + e + f) * 0.25,
+            (d + e + g + h) * 0.25,
+            (e + f + h + i) * 0.25,
+            (j + k + l + m) * 0.25
+        );
+
+        const float boxWeights[5] = float[](0.125, 0.125, 0.125, 0.125, 0.5);
+
+        float totalWeight = 0.0;
+        result = vec3(0.0);
+
+        for (int box = 0; box < 5; box++)
+        {
+            const float weight = boxWeights[box] * karisWeight(boxes[box]);
+
+            result += boxes[box] * weight;
+            totalWeight += weight;
+        }
+
+        result /= totalWeight;
+    }
+    else
+    {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+
+    imageStore(uOutputImage, texel, vec4(result, 1.0));
+}
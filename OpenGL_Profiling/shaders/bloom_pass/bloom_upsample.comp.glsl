@@ -0,0 +1,41 @@
+#version 460
+
+// 3x3 tent upsample, added on top of the downsample already in the target mip
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uSourceTexture; // Must be linearly filtered
+uniform int uSourceLevel;
+uniform float uFilterRadius; // In source texels
+
+layout (rgba16f, binding = 0) uniform image2D uOutputImage;
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const ivec2 outputSize = imageSize(uOutputImage);
+
+    if (any(greaterThanEqual(texel, outputSize))) return;
+
+    const vec2 uv = (vec2(texel) + 0.5) / vec2(outputSize);
+    const vec2 offset = uFilterRadius / vec2(textureSize(uSourceTexture, uSourceLevel));
+    const float level = float(uSourceLevel);
+
+    // 1 2 1
+    // 2 4 2 / 16
+    // 1 2 1
+    vec3 result = textureLod(uSourceTexture, uv, level).rgb * 4.0;
+
+    result += textureLod(uSourceTexture, uv + vec2(-offset.x, 0.0), level).rgb * 2.0;
+    result += textureLod(uSourceTexture, uv + vec2( offset.x, 0.0), level).rgb * 2.0;
+    result += textureLod(uSourceTexture, uv + vec2(0.0, -offset.y), level).rgb * 2.0;
+    result += textureLod(uSourceTexture, uv + vec2(0.0,  offset.y), level).rgb * 2.0;
+
+    result += textureLod(uSourceTexture, uv + vec2(-offset.x, -offset.y), level).rgb;
+    result += textureLod(uSourceTexture, uv + vec2( offset.x, -offset.y), level).rgb;
+    result += textureLod(uSourceTexture, uv + vec2(-offset.x,  offset.y), level).rgb;
+    result += textureLod(uSourceTexture, uv + vec2( offset.x,  offset.y), level).rgb;
+
+    result /= 16.0;
+
+    imageStore(uOutputImage, texel, vec4(imageLoad(uOutputImage, texel).rgb + result, 1.0));
+}
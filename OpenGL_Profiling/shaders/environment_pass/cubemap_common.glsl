@@ -0,0 +1,19 @@
+// World space direction through the centre of a texel of a cube face (GL_TEXTURE_CUBE_MAP_POSITIVE_X + face),
+// matches the GL cubemap face layout
+vec3 getCubemapDirection(ivec2 texel, int face, int faceDimensions)
+{
+    const vec2 uv = (vec2(texel) + 0.5) / float(faceDimensions) * 2.0 - 1.0;
+
+    vec3 direction;
+    switch (face)
+    {
+    case 0: direction = vec3( 1.0, -uv.y, -uv.x); break;
+    case 1: direction = vec3(-1.0, -uv.y,  uv.x); break;
+    case 2: direction = vec3( uv.x,  1.0,  uv.y); break;
+    case 3: direction = vec3( uv.x, -1.0, -uv.y); break;
+    case 4: direction = vec3( uv.x, -uv.y,  1.0); break;
+    default: direction = vec3(-uv.x, -uv.y, -1.0); break;
+    }
+
+    return normalize(direction);
+}
\ No newline at end of file
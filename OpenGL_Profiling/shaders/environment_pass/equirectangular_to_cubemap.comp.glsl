@@ -0,0 +1,26 @@
+#version 460
+
+#include "cubemap_common.glsl"
+
+// All six faces in one dispatch, z is the face
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform sampler2D uEquirectangularMap;
+
+layout (rgba16f, binding = 0) uniform writeonly imageCube uCubemap;
+
+void main()
+{
+    const ivec3 texel = ivec3(gl_GlobalInvocationID);
+    const int faceDimensions = imageSize(uCubemap).x;
+
+    if (any(greaterThanEqual(texel.xy, ivec2(faceDimensions)))) return;
+
+    const vec3 direction = getCubemapDirection(texel.xy, texel.z, faceDimensions);
+
+    vec2 uv = vec2(atan(direction.z, direction.x), asin(direction.y));
+    uv *= vec2(0.1591, 0.3183);
+    uv += 0.5;
+
+    imageStore(uCubemap, texel, vec4(textureLod(uEquirectangularMap, uv, 0.0).rgb, 1.0));
+}
\ No newline at end of file
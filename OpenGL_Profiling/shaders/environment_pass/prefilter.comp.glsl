@@ -0,0 +1,68 @@
+#version 460
+
+#include "../pbr_functions.glsl"
+#include "cubemap_common.glsl"
+
+// One mip of the prefiltered map per dispatch, z is the face
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform samplerCube uEnvironmentMap; // Fully mipped
+uniform float uRoughness;
+
+layout (rgba16f, binding = 0) uniform writeonly imageCube uPrefilteredMap;
+
+// Filtered importance sampling (Krivanek & Colbert, GPU Gems 3 ch. 20): each sample reads the source mip
+// matching its share of the lobe, so the mip chain does most of the integration and few samples are needed
+const uint SAMPLE_COUNT = 64u;
+
+void main()
+{
+    const ivec3 texel = ivec3(gl_GlobalInvocationID);
+    const int faceDimensions = imageSize(uPrefilteredMap).x;
+
+    if (any(greaterThanEqual(texel.xy, ivec2(faceDimensions)))) return;
+
+    // Split sum approximation, assumes N = V = R
+    const vec3 N = getCubemapDirection(texel.xy, texel.z, faceDimensions);
+    const vec3 V = N;
+
+    const float environmentDimensions = float(textureSize(uEnvironmentMap, 0).x);
+
+    // A mirror, just the source at this face's resolution
+    if (uRoughness == 0.0)
+    {
+        const float mipLevel = log2(environmentDimensions / float(faceDimensions));
+
+        imageStore(uPrefilteredMap, texel, vec4(textureLod(uEnvironmentMap, N, mipLevel).rgb, 1.0));
+        return;
+    }
+
+    const float saTexel = 4.0 * PI / (6.0 * environmentDimensions * environmentDimensions);
+
+    float totalWeight = 0.0;
+    vec3 prefilteredColour = vec3(0.0);
+    for (uint i = 0u; i < SAMPLE_COUNT; ++i)
+    {
+        const vec2 Xi = Hammersley(i, SAMPLE_COUNT);
+        const vec3 H = ImportanceSampleGGX(Xi, N, uRoughness);
+        const vec3 L = normalize(2.0 * dot(V, H) * H - V);
+
+        const float NdotL = max(dot(N, L), 0.0);
+        if (NdotL > 0.0)
+        {
+            const float NdotH = max(dot(N, H), 0.0);
+            const float HdotV = max(dot(H, V), 0.0);
+
+            // D_GGX takes alpha, ImportanceSampleGGX squares the roughness itself
+            const float pdf = D_GGX(NdotH, uRoughness * uRoughness) * NdotH / (4.0 * HdotV) + 0.0001;
+            const float saSample = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
+
+            const float mipLevel = max(0.5 * log2(saSample / saTexel), 0.0);
+
+            prefilteredColour += textureLod(uEnvironmentMap, L, mipLevel).rgb * NdotL;
+            totalWeight += NdotL;
+        }
+    }
+
+    imageStore(uPrefilteredMap, texel, vec4(prefilteredColour / totalWeight, 1.0));
+}
\ No newline at end of file
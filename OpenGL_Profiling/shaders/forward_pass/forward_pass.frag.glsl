@@ -3,6 +3,8 @@
 #include "../uniforms_common.glsl"
 #include "../fragment_common.glsl"
 #include "../pbr_functions.glsl"
+#include "../shadows.glsl"
+#include "../reflection_probes.glsl"
 #include "../pbr.glsl"
 
 in VS_OUT
@@ -11,40 +13,46 @@ in VS_OUT
     vec3 normal;
     vec3 viewPos;
     vec2 texCoords;
+    vec4 currentClipPos;
+    vec4 previousClipPos;
 } fs_in;
 
-out vec4 vFragColour;
+layout (location = 0) out vec4 vFragColour;
+layout (location = 1) out vec2 vVelocity; // Current - previous, in UVs. Only has an attachment with TAA on
+layout (location = 2) out vec4 vAmbient; // The ambient part of vFragColour for SSAO to occlude. Only has an attachment with SSAO on
 
 void main()
 {
     vec4 baseColour = uBaseColour.factor;
-	if (uBaseColour.isTextureEnabled)
-	{
-		baseColour *= texture(uBaseColour.textureMap, fs_in.texCoords);
-	}
+#if BASE_COLOUR_TEXTURE
+	baseColour *= texture(uBaseColour.textureMap, fs_in.texCoords);
+#endif
 
 	float roughness = uMetallicRoughness.factor.g;
 	float metalMask = uMetallicRoughness.factor.b;
-	if (uMetallicRoughness.isTextureEnabled)
-	{
-		vec3 mr = texture(uMetallicRoughness.textureMap, fs_in.texCoords).rgb;
-		roughness *= mr.g;
-		metalMask *= mr.b;
-	}
+#if METALLIC_ROUGHNESS_TEXTURE
+	vec3 mr = texture(uMetallicRoughness.textureMap, fs_in.texCoords).rgb;
+	roughness *= mr.g;
+	metalMask *= mr.b;
+#endif
 
 	vec3 normalVector = normalize(fs_in.normal);
 
-	if (uNormalMap.isTextureEnabled)
-	{
-		vec3 textureNormal = texture(uNormalMap.textureMap, fs_in.texCoords).rgb;
-		vec3 scaledNormal;
-		scaledNormal.xy = (textureNormal.rg * 2 - 1) * uNormalMap.factor.x;
-		scaledNormal.z = (textureNormal.b * 2 - 1);
+#if NORMAL_TEXTURE
+	vec3 textureNormal = texture(uNormalMap.textureMap, fs_in.texCoords).rgb;
+	vec3 scaledNormal;
+	scaledNormal.xy = (textureNormal.rg * 2 - 1) * uNormalMap.factor.x;
+	scaledNormal.z = (textureNormal.b * 2 - 1);
 
-		normalVector = normalize(getTBN(fs_in.worldPos, fs_in.normal, fs_in.texCoords) * scaledNormal);
-	}
+	normalVector = normalize(getTBN(fs_in.worldPos, fs_in.normal, fs_in.texCoords) * scaledNormal);
+#endif
 
+    // Probe captures share this shader, seen from the probe
+#if PROBE_CAPTURE
+    const vec3 viewVector = normalize(uProbePosition - fs_in.worldPos);
+#else
     const vec3 viewVector = normalize(uCameraPosition - fs_in.worldPos);
+#endif
 
     vec3 Lo = vec3(0.0);
 
@@ -58,7 +66,12 @@ void main()
             viewVector,
             fs_in.worldPos,
             normalize(bPointLights[i].position.xyz - fs_in.worldPos),
-            attenuatePointLight(bPointLights[i].position.xyz, bPointLights[i].radiance.rgb, fs_in.worldPos)
+            attenuatePointLight(bPointLights[i].position.xyz, bPointLights[i].radiance.rgb, fs_in.worldPos),
+#if SHADOWS_ENABLED
+            samplePointShadow(i, fs_in.worldPos)
+#else
+            0.0
+#endif
         );
     }
 
@@ -72,14 +85,28 @@ void main()
             viewVector,
             fs_in.worldPos,
             bDirectionalLights[i].direction.xyz,
-            bDirectionalLights[i].radiance.rgb
+            bDirectionalLights[i].radiance.rgb,
+            DIRECTIONAL_SHADOW
         );
     }
 
-    if (uOcclusionMap.isTextureEnabled)
-	{
-		Lo = mix(Lo, Lo * texture(uOcclusionMap.textureMap, fs_in.texCoords).r, uOcclusionMap.factor.r);
-	}
+    vec3 ambient = vec3(0.0);
+#if ENVIRONMENT_MAP_ENABLED
+    ambient = calculateAmbientContribution(baseColour.rgb, roughness, metalMask, normalVector, viewVector, fs_in.worldPos);
+    Lo += ambient;
+#endif
+
+#if OCCLUSION_TEXTURE
+	const float occlusion = mix(1.0, texture(uOcclusionMap.textureMap, fs_in.texCoords).r, uOcclusionMap.factor.r);
+	Lo *= occlusion;
+	ambient *= occlusion;
+#endif
 
 	vFragColour = vec4(Lo, baseColour.a);
+    vAmbient = vec4(ambient, baseColour.a);
+
+    vVelocity = vec2(0.0);
+#if TAA_ENABLED
+    vVelocity = (fs_in.currentClipPos.xy / fs_in.currentClipPos.w - fs_in.previousClipPos.xy / fs_in.previousClipPos.w) * 0.5;
+#endif
 }
\ No newline at end of file
@@ -9,6 +9,8 @@ out VS_OUT
     vec3 normal;
     vec3 viewPos;
     vec2 texCoords;
+    vec4 currentClipPos; // Both unjittered, for the velocity output
+    vec4 previousClipPos;
 } vs_out;
 
 void main()
@@ -21,4 +23,11 @@ void main()
     vs_out.texCoords = aTexCoords;
 
     gl_Position = uProjectionMatrix * vec4(vs_out.viewPos, 1.0);
+
+#if TAA_ENABLED
+    const vec3 previousPosition = applyPreviousSkinning(aPosition, aBoneIds, aBoneWeights);
+
+    vs_out.currentClipPos = gl_Position - vec4(uJitter * gl_Position.w, 0.0, 0.0);
+    vs_out.previousClipPos = uPreviousViewProjectionMatrix * uPreviousModelMatrix * vec4(previousPosition, 1.0);
+#endif
 }
\ No newline at end of file
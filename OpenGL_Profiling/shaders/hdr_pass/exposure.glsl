@@ -0,0 +1,24 @@
+// Auto exposure state, lives on the GPU between frames (never read back)
+
+#define NUM_HISTOGRAM_BINS 256
+
+layout(std430) buffer LuminanceHistogramBuffer
+{
+    uint bHistogram[NUM_HISTOGRAM_BINS];
+};
+
+layout(std430) buffer ExposureBuffer
+{
+    float bAverageLuminance; // Smoothed over time
+    float bExposure;
+};
+
+// Bin 0 is reserved for (near) black pixels so they don't drag the average down
+uint luminanceToBin(float luminance, float minLogLuminance, float inverseLogLuminanceRange)
+{
+    if (luminance < 1e-4) return 0;
+
+    const float logLuminance = clamp((log2(luminance) - minLogLuminance) * inverseLogLuminanceRange, 0.0, 1.0);
+
+    return uint(logLuminance * float(NUM_HISTOGRAM_BINS - 2) + 1.0);
+}
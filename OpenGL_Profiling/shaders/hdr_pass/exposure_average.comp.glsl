@@ -0,0 +1,52 @@
+#version 460
+
+// Single group, reduces the histogram to a weighted average and clears it for next frame
+layout (local_size_x = 256) in;
+
+uniform uint uNumPixels;
+uniform float uMinLogLuminance;
+uniform float uLogLuminanceRange;
+
+uniform float uDeltaTime;
+uniform float uAdaptationRate;
+
+#include "exposure.glsl"
+
+// Middle grey
+const float EXPOSURE_KEY = 0.18;
+
+shared float sWeightedCounts[NUM_HISTOGRAM_BINS];
+
+void main()
+{
+    const uint bin = gl_LocalInvocationIndex;
+    const uint count = bHistogram[bin];
+
+    sWeightedCounts[bin] = float(count) * float(bin);
+    bHistogram[bin] = 0;
+
+    // Black pixels are left out of the average entirely
+    const uint blackPixels = bin == 0 ? count : 0;
+
+    barrier();
+
+    for (uint cutoff = NUM_HISTOGRAM_BINS / 2; cutoff > 0; cutoff >>= 1)
+    {
+        if (bin < cutoff) sWeightedCounts[bin] += sWeightedCounts[bin + cutoff];
+        barrier();
+    }
+
+    if (bin != 0) return;
+
+    const float litPixels = float(uNumPixels) - float(blackPixels);
+    if (litPixels < 1.0) return; // Nothing to adapt to
+
+    // Back from bin index to log2 luminance, using the centre of the bins
+    const float averageBin = sWeightedCounts[0] / litPixels - 0.5;
+    const float averageLuminance = exp2(averageBin / float(NUM_HISTOGRAM_BINS - 2) * uLogLuminanceRange + uMinLogLuminance);
+
+    const float adaptation = 1.0 - exp(-uDeltaTime * uAdaptationRate);
+
+    bAverageLuminance = mix(bAverageLuminance, averageLuminance, adaptation);
+    bExposure = EXPOSURE_KEY / max(bAverageLuminance, 1e-4);
+}
@@ -0,0 +1,38 @@
+#version 460
+
+// Compute version of hdr_pass.frag.glsl, skips the raster pipeline and writes straight to the LDR target
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uColourTexture;
+uniform ivec2 uOutputDimensions; // Can be bigger than the HDR target, it's upscaled on the way
+
+layout (rgba8, binding = 0) uniform writeonly image2D uOutputImage;
+
+uniform bool uAutoExposure;
+
+uniform sampler2D uBloomTexture;
+uniform bool uBloomEnabled;
+uniform float uBloomStrength;
+
+#include "exposure.glsl"
+#include "tonemap.glsl"
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+    if (any(greaterThanEqual(texel, uOutputDimensions))) return;
+
+    const vec2 uv = (vec2(texel) + 0.5) / vec2(uOutputDimensions);
+
+    vec3 colour = textureLod(uColourTexture, uv, 0.0).rgb;
+
+    if (uBloomEnabled) colour = mix(colour, textureLod(uBloomTexture, uv, 0.0).rgb, uBloomStrength);
+
+    if (uAutoExposure) colour *= bExposure;
+
+    colour = ACESFilm(colour);
+    colour = fromLinear(colour);
+
+    imageStore(uOutputImage, texel, vec4(colour, 1.0));
+}
@@ -1,30 +1,18 @@
 #version 460
 
 uniform sampler2D uColourTexture;
-uniform vec2 uScreenDimensions;
+uniform vec2 uScreenDimensions; // Output size, the HDR target is bilinearly upscaled if it's smaller
 
 out vec4 vFragColour;
 
-// https://knarkowicz.wordpress.com/2016/01/06/aces-filmic-tone-mapping-curve/
-vec3 ACESFilm(vec3 x)
-{
-    float a = 2.51f;
-    float b = 0.03f;
-    float c = 2.43f;
-    float d = 0.59f;
-    float e = 0.14f;
-    return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
-}
-
-// Converts a color from linear light gamma to sRGB gamma
-vec3 fromLinear(vec3 linearRGB)
-{
-    bvec3 cutoff = lessThan(linearRGB.rgb, vec3(0.0031308));
-    vec3 higher = vec3(1.055) * pow(linearRGB.rgb, vec3(1.0 / 2.4)) - vec3(0.055);
-    vec3 lower = linearRGB.rgb * vec3(12.92);
+uniform bool uAutoExposure;
+
+uniform sampler2D uBloomTexture;
+uniform bool uBloomEnabled;
+uniform float uBloomStrength;
 
-    return mix(higher, lower, cutoff);
-}
+#include "exposure.glsl"
+#include "tonemap.glsl"
 
 void main()
 {
@@ -32,6 +20,10 @@ void main()
 
     vec3 colour = texture(uColourTexture, uvs).rgb;
 
+    if (uBloomEnabled) colour = mix(colour, textureLod(uBloomTexture, uvs, 0.0).rgb, uBloomStrength);
+
+    if (uAutoExposure) colour *= bExposure;
+
     colour = ACESFilm(colour);
     colour = fromLinear(colour);
 
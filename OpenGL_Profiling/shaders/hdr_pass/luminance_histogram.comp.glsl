@@ -0,0 +1,36 @@
+#version 460
+
+// One thread per bin, so the local bins can be cleared and flushed without a loop
+layout (local_size_x = 16, local_size_y = 16) in;
+
+uniform sampler2D uColourTexture;
+uniform ivec2 uScreenDimensions;
+
+uniform float uMinLogLuminance;
+uniform float uInverseLogLuminanceRange;
+
+#include "exposure.glsl"
+
+shared uint sHistogram[NUM_HISTOGRAM_BINS];
+
+void main()
+{
+    sHistogram[gl_LocalInvocationIndex] = 0;
+    barrier();
+
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+    if (all(lessThan(texel, uScreenDimensions)))
+    {
+        const vec3 colour = texelFetch(uColourTexture, texel, 0).rgb;
+        const float luminance = dot(colour, vec3(0.2126, 0.7152, 0.0722));
+
+        atomicAdd(sHistogram[luminanceToBin(luminance, uMinLogLuminance, uInverseLogLuminanceRange)], 1);
+    }
+
+    barrier();
+
+    // Only touch global memory for bins this group actually hit
+    const uint count = sHistogram[gl_LocalInvocationIndex];
+    if (count > 0) atomicAdd(bHistogram[gl_LocalInvocationIndex], count);
+}
@@ -0,0 +1,44 @@
+#version 460
+
+// Contrast adaptive sharpening (AMD FidelityFX CAS), sharpens less where there's already contrast so it doesn't ring
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uSourceTexture;
+uniform float uSharpness; // [0, 1]
+
+layout (rgba8, binding = 0) uniform writeonly image2D uOutputImage;
+
+vec3 fetchSource(ivec2 texel)
+{
+    return texelFetch(uSourceTexture, clamp(texel, ivec2(0), textureSize(uSourceTexture, 0) - 1), 0).rgb;
+}
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const ivec2 outputSize = imageSize(uOutputImage);
+
+    if (any(greaterThanEqual(texel, outputSize))) return;
+
+    //   b
+    // d e f
+    //   h
+    const vec3 b = fetchSource(texel + ivec2( 0,  1));
+    const vec3 d = fetchSource(texel + ivec2(-1,  0));
+    const vec3 e = fetchSource(texel);
+    const vec3 f = fetchSource(texel + ivec2( 1,  0));
+    const vec3 h = fetchSource(texel + ivec2( 0, -1));
+
+    const vec3 minColour = min(min(min(d, e), min(f, b)), h);
+    const vec3 maxColour = max(max(max(d, e), max(f, b)), h);
+
+    // Per channel amount, smaller the closer the neighbourhood already gets to 0 or 1
+    const vec3 amplitude = sqrt(clamp(min(minColour, 1.0 - maxColour) / max(maxColour, vec3(1e-5)), 0.0, 1.0));
+
+    const float peak = -1.0 / mix(8.0, 5.0, uSharpness);
+    const vec3 weight = amplitude * peak;
+
+    const vec3 colour = ((b + d + f + h) * weight + e) / (1.0 + 4.0 * weight);
+
+    imageStore(uOutputImage, texel, vec4(clamp(colour, 0.0, 1.0), 1.0));
+}
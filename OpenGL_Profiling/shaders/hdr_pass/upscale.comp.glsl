@@ -0,0 +1,126 @@
+#version 460
+
+// Edge adaptive spatial upsample, a cut down take on AMD FidelityFX FSR 1's EASU.
+// Runs on the tonemapped (perceptual) image, fits a Lanczos-like kernel to each pixel's
+// 12 tap neighbourhood, stretched along the local edge and squashed across it
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uSourceTexture;
+
+layout (rgba8, binding = 0) uniform writeonly image2D uOutputImage;
+
+vec3 fetchSource(ivec2 texel)
+{
+    return texelFetch(uSourceTexture, clamp(texel, ivec2(0), textureSize(uSourceTexture, 0) - 1), 0).rgb;
+}
+
+float luma(vec3 colour)
+{
+    return dot(colour, vec3(0.299, 0.587, 0.114));
+}
+
+// Kernel lobe, x2 is squared distance. Windowed approximation of Lanczos 2 (no trig)
+float kernelWeight(float x2, float lobe)
+{
+    float window = 0.4 * x2 - 1.0;
+    float base = lobe * x2 - 1.0;
+
+    window *= window;
+    base *= base;
+
+    return (25.0 / 16.0 * window - (25.0 / 16.0 - 1.0)) * base;
+}
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const ivec2 outputSize = imageSize(uOutputImage);
+
+    if (any(greaterThanEqual(texel, outputSize))) return;
+
+    const vec2 sourcePosition = (vec2(texel) + 0.5) * vec2(textureSize(uSourceTexture, 0)) / vec2(outputSize) - 0.5;
+    const ivec2 base = ivec2(floor(sourcePosition));
+    const vec2 fraction = sourcePosition - vec2(base);
+
+    // 4x4 neighbourhood, [1][1] is the texel at base
+    vec3 colours[4][4];
+    float lumas[4][4];
+
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            colours[y][x] = fetchSource(base + ivec2(x - 1, y - 1));
+            lumas[y][x] = luma(colours[y][x]);
+        }
+    }
+
+    // Edge direction and strength from the central 2x2, bilinearly weighted
+    const vec4 bilinear = vec4(
+        (1.0 - fraction.x) * (1.0 - fraction.y),
+        fraction.x * (1.0 - fraction.y),
+        (1.0 - fraction.x) * fraction.y,
+        fraction.x * fraction.y);
+
+    const ivec2 centres[4] = ivec2[](ivec2(1, 1), ivec2(2, 1), ivec2(1, 2), ivec2(2, 2));
+
+    vec2 direction = vec2(0.0);
+    float edge = 0.0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        const int x = centres[i].x;
+        const int y = centres[i].y;
+
+        const float left = lumas[y][x - 1], right = lumas[y][x + 1];
+        const float down = lumas[y - 1][x], up = lumas[y + 1][x];
+        const float centre = lumas[y][x];
+
+        direction += vec2(right - left, up - down) * bilinear[i];
+
+        // A one sided step is an edge, a symmetric one (a line or noise) isn't
+        const float edgeX = clamp(abs(right - left) / max(max(abs(right - centre), abs(centre - left)), 1e-5), 0.0, 1.0);
+        const float edgeY = clamp(abs(up - down) / max(max(abs(up - centre), abs(centre - down)), 1e-5), 0.0, 1.0);
+
+        edge += (edgeX * edgeX + edgeY * edgeY) * 0.5 * bilinear[i];
+    }
+
+    const float directionLength2 = dot(direction, direction);
+    direction = directionLength2 < 1e-10 ? vec2(1.0, 0.0) : direction * inversesqrt(directionLength2);
+
+    // Diagonal edges need more stretch to reach the same taps
+    const float stretch = 1.0 / max(abs(direction.x), abs(direction.y));
+    const vec2 axisScale = vec2(1.0 + (stretch - 1.0) * edge, 1.0 - 0.5 * edge);
+
+    // Sharper negative lobe on strong edges
+    const float lobe = 0.5 + ((1.0 / 4.0 - 0.04) - 0.5) * edge;
+    const float maxDistance2 = 1.0 / lobe;
+
+    vec3 colour = vec3(0.0);
+    float totalWeight = 0.0;
+
+    for (int y = 0; y < 4; y++)
+    {
+        for (int x = 0; x < 4; x++)
+        {
+            // 12 taps, the corners are too far away to matter
+            if ((x == 0 || x == 3) && (y == 0 || y == 3)) continue;
+
+            const vec2 offset = vec2(x - 1, y - 1) - fraction;
+            const vec2 rotated = vec2(dot(offset, direction), dot(offset, vec2(-direction.y, direction.x))) * axisScale;
+
+            const float weight = kernelWeight(min(dot(rotated, rotated), maxDistance2), lobe);
+
+            colour += colours[y][x] * weight;
+            totalWeight += weight;
+        }
+    }
+
+    colour /= totalWeight;
+
+    // Dering against the nearest 2x2
+    const vec3 minColour = min(min(colours[1][1], colours[1][2]), min(colours[2][1], colours[2][2]));
+    const vec3 maxColour = max(max(colours[1][1], colours[1][2]), max(colours[2][1], colours[2][2]));
+
+    imageStore(uOutputImage, texel, vec4(clamp(colour, minColour, maxColour), 1.0));
+}
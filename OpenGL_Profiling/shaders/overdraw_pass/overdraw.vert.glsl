@@ -0,0 +1,12 @@
+#version 460
+
+#include "../vertex_common.glsl"
+#include "../uniforms_common.glsl"
+
+// The forward pass's transform and nothing else, counting its fragments needs no attributes
+void main()
+{
+    SkinnedVertex vtx = applySkinning(aPosition, aNormal, aBoneIds, aBoneWeights);
+
+    gl_Position = uProjectionMatrix * uViewMatrix * uModelMatrix * vec4(vtx.position, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 460
+
+// One for every fragment shaded, blended additively into the count
+layout (location = 0) out float vCount;
+
+void main()
+{
+    vCount = 1.0;
+}
@@ -0,0 +1,45 @@
+#version 460
+
+// Overdraw counts to colour, at output size. Black where nothing was drawn, then blue for a single fragment
+// through green, yellow and red as it approaches uMaxOverdraw, white at and above it
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uOverdrawTexture; // Render size
+uniform int uMaxOverdraw;
+
+layout (rgba8, binding = 0) uniform writeonly image2D uOutputImage;
+
+vec3 heatmap(float t)
+{
+    const vec3 colours[4] = vec3[](vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0));
+
+    const float scaled = clamp(t, 0.0, 1.0) * 3.0;
+    const int segment = min(int(scaled), 2);
+
+    return mix(colours[segment], colours[segment + 1], scaled - float(segment));
+}
+
+void main()
+{
+    const ivec2 outputDimensions = imageSize(uOutputImage);
+    const ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+
+    if (any(greaterThanEqual(pixel, outputDimensions))) return;
+
+    // Nearest, the render target can be smaller than the output
+    const ivec2 renderPixel = pixel * textureSize(uOverdrawTexture, 0) / outputDimensions;
+    const float count = texelFetch(uOverdrawTexture, renderPixel, 0).r;
+
+    vec3 colour = vec3(0.0);
+
+    if (count >= float(uMaxOverdraw))
+    {
+        colour = vec3(1.0);
+    }
+    else if (count >= 1.0)
+    {
+        colour = heatmap((count - 1.0) / float(uMaxOverdraw - 1));
+    }
+
+    imageStore(uOutputImage, pixel, vec4(colour, 1.0));
+}
@@ -1,7 +1,11 @@
+#include "uniforms_common.glsl"
+#include "pbr_functions.glsl"
+#include "reflection_probes.glsl"
+
+// Whether textureMap is used is a permutation feature (BASE_COLOUR_TEXTURE etc), not a uniform
 struct MaterialInput
 {
     vec4 factor;
-    bool isTextureEnabled;
     sampler2D textureMap;
 };
 
@@ -10,6 +14,11 @@ uniform MaterialInput uMetallicRoughness;
 uniform MaterialInput uNormalMap;
 uniform MaterialInput uOcclusionMap;
 
+uniform samplerCube uPrefilteredMap;
+uniform sampler2D uBRDF;
+
+const float MAX_REFLECTION_LOD = 4.0; // Prefiltered mips - 1
+
 vec3 calculateLightContribution(
     vec3 baseColour,
     float roughness,
@@ -18,7 +27,8 @@ vec3 calculateLightContribution(
     vec3 viewVector,
     vec3 fragPosition,
     vec3 lightVector, // Assumed to be normalized, vector to light source
-    vec3 lightAttenuatedRadiance // Assumes no attenuation, must be done separately
+    vec3 lightAttenuatedRadiance, // Assumes no attenuation, must be done separately
+    float shadow // 1.0 = fully shadowed
 )
 {
     const vec3 diffuseColour = (1 - metalMask) * baseColour;
@@ -47,13 +57,6 @@ vec3 calculateLightContribution(
 
     const float Fd = Fd_Burley(NdotV, NdotL, LdotH, roughness); // Diffuse
 
-    float shadow = 0.0;
-
-    if (uShadowsEnabled)
-    {
-        // todo: do shadows
-    }
-
     return (diffuseColour * Fd + Fr) * lightAttenuatedRadiance * NdotL * (1.0 - shadow);
 }
 
@@ -66,4 +69,59 @@ vec3 attenuatePointLight(
     const float lightDistance = length(lightPosition - fragPosition);
     const float attenuation = 1.0 / (lightDistance * lightDistance); // Simple attenuation
     return lightRadiance * attenuation;
+}
+// Diffuse irradiance from the environment's SH, already divided by pi so it multiplies the albedo directly
+vec3 evaluateIrradianceSH(vec3 n)
+{
+    const vec3 irradiance =
+        uIrradianceSH[0].rgb * 0.282095 +
+        uIrradianceSH[1].rgb * 0.488603 * n.y +
+        uIrradianceSH[2].rgb * 0.488603 * n.z +
+        uIrradianceSH[3].rgb * 0.488603 * n.x +
+        uIrradianceSH[4].rgb * 1.092548 * n.x * n.y +
+        uIrradianceSH[5].rgb * 1.092548 * n.y * n.z +
+        uIrradianceSH[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0) +
+        uIrradianceSH[7].rgb * 1.092548 * n.x * n.z +
+        uIrradianceSH[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+
+    // L2 can ring slightly negative opposite very bright, small sources
+    return max(irradiance, 0.0);
+}
+
+// Image based lighting, SH diffuse + split sum specular from the local probes, or the environment outside them
+vec3 calculateAmbientContribution(
+    vec3 baseColour,
+    float roughness,
+    float metalMask,
+    vec3 normalVector,
+    vec3 viewVector,
+    vec3 fragPosition
+)
+{
+    const vec3 diffuseColour = (1 - metalMask) * baseColour;
+
+    const float reflectance = 0.5;
+    const float dielectricReflectance = 0.16 * reflectance * reflectance;
+    const vec3 F0 = dielectricReflectance * (1.0 - metalMask) + baseColour.rgb * metalMask;
+
+    const float NdotV = max(dot(normalVector, viewVector), 1e-5);
+
+    const vec3 F = F_Schlick(NdotV, F0, roughness);
+
+    const vec3 diffuse = (1.0 - F) * diffuseColour * evaluateIrradianceSH(normalVector);
+
+    const vec3 R = reflect(-viewVector, normalVector);
+    const float lod = roughness * MAX_REFLECTION_LOD;
+
+    vec3 prefiltered = textureLod(uPrefilteredMap, R, lod).rgb;
+#if REFLECTION_PROBES_ENABLED && !PROBE_CAPTURE
+    const vec4 local = sampleReflectionProbes(fragPosition, R, lod);
+    prefiltered = local.rgb + prefiltered * (1.0 - local.a);
+#endif
+
+    const vec2 brdf = texture(uBRDF, vec2(NdotV, roughness)).rg;
+
+    const vec3 specular = prefiltered * (F0 * brdf.x + brdf.y);
+
+    return diffuse + specular;
 }
\ No newline at end of file
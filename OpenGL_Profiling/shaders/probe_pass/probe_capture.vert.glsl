@@ -0,0 +1,33 @@
+#version 460
+
+#include "../vertex_common.glsl"
+#include "../uniforms_common.glsl"
+
+// One face of a reflection probe, pairs with the forward pass's fragment shader
+uniform mat4 uCaptureViewProjection;
+
+out VS_OUT
+{
+    vec3 worldPos;
+    vec3 normal;
+    vec3 viewPos;
+    vec2 texCoords;
+    vec4 currentClipPos;
+    vec4 previousClipPos;
+} vs_out;
+
+void main()
+{
+    SkinnedVertex vtx = applySkinning(aPosition, aNormal, aBoneIds, aBoneWeights);
+
+    vs_out.worldPos = (uModelMatrix * vec4(vtx.position, 1.0)).xyz;
+    vs_out.normal = uNormalMatrix * vtx.normal;
+    vs_out.viewPos = (uViewMatrix * vec4(vs_out.worldPos, 1.0)).xyz;
+    vs_out.texCoords = aTexCoords;
+
+    gl_Position = uCaptureViewProjection * vec4(vs_out.worldPos, 1.0);
+
+    // Nothing moves in a capture
+    vs_out.currentClipPos = gl_Position;
+    vs_out.previousClipPos = gl_Position;
+}
\ No newline at end of file
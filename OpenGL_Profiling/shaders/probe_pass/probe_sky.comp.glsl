@@ -0,0 +1,27 @@
+#version 460
+
+#include "../environment_pass/cubemap_common.glsl"
+
+// The environment behind a probe's geometry, all six faces in one dispatch
+layout (local_size_x = 8, local_size_y = 8, local_size_z = 1) in;
+
+uniform samplerCube uPrefilteredMap; // Mip 0 is the unfiltered environment
+uniform bool uEnvironmentEnabled;
+
+layout (rgba16f, binding = 0) uniform writeonly imageCube uCubemap;
+
+void main()
+{
+    const ivec3 texel = ivec3(gl_GlobalInvocationID);
+    const int faceDimensions = imageSize(uCubemap).x;
+
+    if (any(greaterThanEqual(texel.xy, ivec2(faceDimensions)))) return;
+
+    vec3 sky = vec3(0.0);
+    if (uEnvironmentEnabled)
+    {
+        sky = textureLod(uPrefilteredMap, getCubemapDirection(texel.xy, texel.z, faceDimensions), 0.0).rgb;
+    }
+
+    imageStore(uCubemap, texel, vec4(sky, 1.0));
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+// Local reflection probes: box projected cubemaps in one array, blended by how far inside each box the point is
+
+uniform samplerCubeArray uReflectionProbes;
+
+// With PROBE_CAPTURE, rendering a probe's faces. They only see the environment, not each other
+uniform vec3 uProbePosition;
+
+struct ReflectionProbe
+{
+    vec4 position; // X Y Z + layer in uReflectionProbes
+    vec4 boxMin;   // X Y Z + blend distance
+    vec4 boxMax;   // X Y Z + padding
+};
+
+// Ready probes only, smallest box first
+layout(std430) buffer ReflectionProbeBuffer
+{
+    ReflectionProbe bReflectionProbes[];
+};
+
+// 0 outside the box, 1 once the point is blend distance inside it
+float getProbeWeight(ReflectionProbe probe, vec3 worldPos)
+{
+    const vec3 inside = min(worldPos - probe.boxMin.xyz, probe.boxMax.xyz - worldPos);
+
+    return clamp(min(min(inside.x, inside.y), inside.z) / max(probe.boxMin.w, 1e-4), 0.0, 1.0);
+}
+
+// Where R leaves the box, as seen from the probe's capture point
+vec3 getParallaxCorrectedDirection(ReflectionProbe probe, vec3 worldPos, vec3 R)
+{
+    const vec3 toMax = (probe.boxMax.xyz - worldPos) / R;
+    const vec3 toMin = (probe.boxMin.xyz - worldPos) / R;
+    const vec3 exits = max(toMax, toMin);
+
+    const float distance = min(min(exits.x, exits.y), exits.z);
+
+    return worldPos + R * distance - probe.position.xyz;
+}
+
+// Prefiltered radiance of the probes covering this point, weighted. A < 1 where the environment should show through
+vec4 sampleReflectionProbes(vec3 worldPos, vec3 R, float lod)
+{
+    vec3 radiance = vec3(0.0);
+    float totalWeight = 0.0;
+
+    for (int i = 0; i < bReflectionProbes.length() && totalWeight < 1.0; i++)
+    {
+        const ReflectionProbe probe = bReflectionProbes[i];
+
+        // Earlier (smaller) probes take what they cover first, later ones only fill the rest
+        const float weight = min(getProbeWeight(probe, worldPos), 1.0 - totalWeight);
+        if (weight <= 0.0) continue;
+
+        const vec3 direction = getParallaxCorrectedDirection(probe, worldPos, R);
+
+        radiance += textureLod(uReflectionProbes, vec4(direction, probe.position.w), lod).rgb * weight;
+        totalWeight += weight;
+    }
+
+    return vec4(radiance, totalWeight);
+}
\ No newline at end of file
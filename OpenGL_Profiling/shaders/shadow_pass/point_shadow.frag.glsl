@@ -0,0 +1,15 @@
+#version 460
+
+#include "../uniforms_common.glsl"
+
+in vec3 gWorldPos;
+
+uniform vec3 uLightPosition;
+
+// Every point shadow projection stores the same normalized linear distance, so lookups only differ in their UVs
+void main()
+{
+    const float lightDistance = length(gWorldPos - uLightPosition);
+
+    gl_FragDepth = (lightDistance - uPointShadowNearPlane) / (uPointShadowFarPlane - uPointShadowNearPlane);
+}
@@ -0,0 +1,29 @@
+#version 460
+
+// Invocation 0 is the +Z hemisphere, 1 is the -Z hemisphere (mirrored)
+layout (triangles, invocations = 2) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+uniform vec3 uLightPosition;
+
+out vec3 gWorldPos;
+
+void main()
+{
+    const float hemisphere = gl_InvocationID == 0 ? 1.0 : -1.0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        vec3 direction = normalize(gl_in[i].gl_Position.xyz - uLightPosition);
+        direction.z *= hemisphere;
+
+        // Depth comes from the fragment shader, so only the xy projection matters here.
+        // The projection is non-linear, so large triangles will bend slightly, that's the trade-off
+        gWorldPos = gl_in[i].gl_Position.xyz;
+        gl_Position = vec4(direction.xy / (1.0 + direction.z), 0.0, 1.0);
+        gl_ClipDistance[0] = direction.z;
+        gl_ViewportIndex = gl_InvocationID;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,21 @@
+#version 460
+
+// One invocation per tetrahedron face, each face has its own viewport inside the light's atlas tile
+layout (triangles, invocations = 4) in;
+layout (triangle_strip, max_vertices = 3) out;
+
+uniform mat4 uViewProjectMatrices[4];
+
+out vec3 gWorldPos;
+
+void main()
+{
+    for (int i = 0; i < 3; i++)
+    {
+        gWorldPos = gl_in[i].gl_Position.xyz;
+        gl_Position = uViewProjectMatrices[gl_InvocationID] * gl_in[i].gl_Position;
+        gl_ViewportIndex = gl_InvocationID;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,11 @@
+#version 460
+
+#include "../vertex_common.glsl"
+
+// World space position, the geometry shader does the projection(s)
+void main()
+{
+    SkinnedVertex vtx = applySkinning(aPosition, aNormal, aBoneIds, aBoneWeights);
+
+    gl_Position = uModelMatrix * vec4(vtx.position, 1.0);
+}
@@ -0,0 +1,149 @@
+// Point shadow lookups, one per PointShadowMode. Every mode stores normalized linear distance from the light,
+// each light's faces are packed into its own tile of the shadow atlas
+
+#define POINT_SHADOW_CUBEMAP 0
+#define POINT_SHADOW_TETRAHEDRAL 1
+#define POINT_SHADOW_DUAL_PARABOLOID 2
+
+uniform sampler2DShadow uShadowAtlas;
+
+struct PointShadow
+{
+    vec4 atlasRect; // X Y tile offset + W H face size, in atlas UVs. Zero size = no tile this frame
+};
+
+layout(std430) buffer PointShadowBuffer
+{
+    PointShadow bPointShadows[];
+};
+
+const float POINT_SHADOW_BIAS = 0.0005;
+
+// Only point lights have shadow maps in the atlas, directional lights are never shadowed
+const float DIRECTIONAL_SHADOW = 0.0;
+
+// MUST match tetrahedronFaces in shadowRenderPass.cpp
+const vec3 TETRAHEDRON_FACES[4] = vec3[](
+    vec3( 0.57735027,  0.57735027,  0.57735027),
+    vec3(-0.57735027, -0.57735027,  0.57735027),
+    vec3(-0.57735027,  0.57735027, -0.57735027),
+    vec3( 0.57735027, -0.57735027, -0.57735027)
+);
+
+// MUST match TETRAHEDRON_TAN_HALF_FOV in shadowRenderPass.cpp
+const float TETRAHEDRON_TAN_HALF_FOV = 2.8284271 * 1.05;
+
+float pointShadowDepth(float lightDistance)
+{
+    return (lightDistance - uPointShadowNearPlane) / (uPointShadowFarPlane - uPointShadowNearPlane);
+}
+
+// Same basis glm::lookAt builds, returns [0, 1] UVs inside the face
+vec2 projectFaceUV(vec3 direction, vec3 forward, vec3 upHint, float tanHalfFov)
+{
+    const vec3 right = normalize(cross(forward, upHint));
+    const vec3 up = cross(right, forward);
+
+    const vec2 ndc = vec2(dot(direction, right), dot(direction, up)) / (dot(direction, forward) * tanHalfFov);
+
+    return ndc * 0.5 + 0.5;
+}
+
+// Face order and up vectors MUST match the cubemap transforms in shadowRenderPass.cpp
+vec2 cubemapFaceUV(vec3 direction, out int face)
+{
+    const vec3 a = abs(direction);
+
+    vec3 forward;
+    vec3 upHint;
+
+    if (a.x >= a.y && a.x >= a.z)
+    {
+        face = direction.x > 0.0 ? 0 : 1;
+        forward = vec3(sign(direction.x), 0.0, 0.0);
+        upHint = vec3(0.0, -1.0, 0.0);
+    }
+    else if (a.y >= a.z)
+    {
+        face = direction.y > 0.0 ? 2 : 3;
+        forward = vec3(0.0, sign(direction.y), 0.0);
+        upHint = vec3(0.0, 0.0, sign(direction.y));
+    }
+    else
+    {
+        face = direction.z > 0.0 ? 4 : 5;
+        forward = vec3(0.0, 0.0, sign(direction.z));
+        upHint = vec3(0.0, -1.0, 0.0);
+    }
+
+    return projectFaceUV(direction, forward, upHint, 1.0);
+}
+
+vec2 tetrahedronFaceUV(vec3 direction, out int face)
+{
+    face = 0;
+    float maxDot = dot(direction, TETRAHEDRON_FACES[0]);
+    for (int i = 1; i < 4; i++)
+    {
+        const float d = dot(direction, TETRAHEDRON_FACES[i]);
+        if (d > maxDot)
+        {
+            maxDot = d;
+            face = i;
+        }
+    }
+
+    return projectFaceUV(direction, TETRAHEDRON_FACES[face], vec3(0.0, 1.0, 0.0), TETRAHEDRON_TAN_HALF_FOV);
+}
+
+vec2 paraboloidFaceUV(vec3 direction, out int face)
+{
+    face = direction.z >= 0.0 ? 0 : 1;
+    direction.z = abs(direction.z);
+
+    return (direction.xy / (1.0 + direction.z)) * 0.5 + 0.5;
+}
+
+// 1.0 = fully shadowed
+float samplePointShadow(int lightIndex, vec3 worldPos)
+{
+    const vec4 atlasRect = bPointShadows[lightIndex].atlasRect;
+    if (atlasRect.z == 0.0) return 0.0;
+
+    const vec3 lightVector = worldPos - bPointLights[lightIndex].position.xyz;
+    const float lightDistance = length(lightVector);
+
+    if (lightDistance > uPointShadowFarPlane) return 0.0;
+
+    const float depth = pointShadowDepth(lightDistance) - POINT_SHADOW_BIAS;
+    const vec3 direction = lightVector / lightDistance;
+
+    int face;
+    vec2 faceUV;
+    int faceColumns;
+
+    if (uPointShadowMode == POINT_SHADOW_TETRAHEDRAL)
+    {
+        faceUV = tetrahedronFaceUV(direction, face);
+        faceColumns = 2;
+    }
+    else if (uPointShadowMode == POINT_SHADOW_DUAL_PARABOLOID)
+    {
+        faceUV = paraboloidFaceUV(direction, face);
+        faceColumns = 2;
+    }
+    else
+    {
+        faceUV = cubemapFaceUV(direction, face);
+        faceColumns = 3;
+    }
+
+    // Keep the filter footprint inside the face, neighbouring faces (and tiles) aren't continuous
+    const vec2 halfTexel = 0.5 / vec2(textureSize(uShadowAtlas, 0));
+    const vec2 faceSize = atlasRect.zw;
+
+    const vec2 faceOffset = atlasRect.xy + vec2(face % faceColumns, face / faceColumns) * faceSize;
+    const vec2 uv = clamp(faceOffset + faceUV * faceSize, faceOffset + halfTexel, faceOffset + faceSize - halfTexel);
+
+    return texture(uShadowAtlas, vec3(uv, depth));
+}
@@ -0,0 +1,119 @@
+#version 460
+
+// Half resolution hemisphere SSAO from linear depth, normals are reconstructed from the depth too.
+// Few samples and a per pixel, per frame rotation; the noise is averaged out by reprojecting last frame's result
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uDepthTexture; // Half resolution linear depth
+uniform sampler2D uHistoryTexture; // Last frame's AO + linear depth, linearly filtered
+
+uniform float uRadius; // World units
+uniform float uBlendFactor; // Weight of the current frame
+uniform bool uHistoryValid;
+uniform uint uFrameIndex;
+
+uniform mat4 uInverseView;
+uniform mat4 uPreviousViewProjection; // Unjittered
+
+layout (rg16f, binding = 0) uniform writeonly image2D uOutputImage; // AO + linear depth, for the bilateral upsample
+
+#include "ssao_common.glsl"
+
+const int NUM_SAMPLES = 12;
+const float GOLDEN_ANGLE = 2.39996323;
+
+// Bias against self occlusion, as a fraction of the depth
+const float DEPTH_BIAS = 0.002;
+
+float interleavedGradientNoise(vec2 position)
+{
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+vec3 fetchViewPosition(ivec2 texel, vec2 texelSize)
+{
+    const float depth = texelFetch(uDepthTexture, texel, 0).r;
+
+    return reconstructViewPosition((vec2(texel) + 0.5) * texelSize, depth);
+}
+
+// Picks the neighbour on the same surface on each axis, so normals don't smear across depth edges
+vec3 reconstructNormal(ivec2 texel, vec3 position, vec2 texelSize)
+{
+    const ivec2 maxTexel = textureSize(uDepthTexture, 0) - 1;
+
+    const vec3 left = fetchViewPosition(max(texel - ivec2(1, 0), ivec2(0)), texelSize);
+    const vec3 right = fetchViewPosition(min(texel + ivec2(1, 0), maxTexel), texelSize);
+    const vec3 down = fetchViewPosition(max(texel - ivec2(0, 1), ivec2(0)), texelSize);
+    const vec3 up = fetchViewPosition(min(texel + ivec2(0, 1), maxTexel), texelSize);
+
+    const vec3 dx = abs(right.z - position.z) < abs(position.z - left.z) ? right - position : position - left;
+    const vec3 dy = abs(up.z - position.z) < abs(position.z - down.z) ? up - position : position - down;
+
+    return normalize(cross(dx, dy));
+}
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const ivec2 size = imageSize(uOutputImage);
+
+    if (any(greaterThanEqual(texel, size))) return;
+
+    const vec2 texelSize = 1.0 / vec2(size);
+    const vec2 uv = (vec2(texel) + 0.5) * texelSize;
+
+    const float linearDepth = texelFetch(uDepthTexture, texel, 0).r;
+    const vec3 position = reconstructViewPosition(uv, linearDepth);
+    const vec3 normal = reconstructNormal(texel, position, texelSize);
+
+    // Random rotation about the normal, a different one every frame
+    const float angle = 6.28318531 * interleavedGradientNoise(vec2(texel) + 5.588238 * float(uFrameIndex % 64u));
+    const vec3 randomVector = vec3(cos(angle), sin(angle), 0.0);
+
+    const vec3 tangent = normalize(randomVector - normal * dot(randomVector, normal));
+    const vec3 bitangent = cross(normal, tangent);
+    const mat3 TBN = mat3(tangent, bitangent, normal);
+
+    float occlusion = 0.0;
+
+    for (int i = 0; i < NUM_SAMPLES; i++)
+    {
+        // Spiral over the hemisphere, denser towards the centre
+        const float t = (float(i) + 0.5) / float(NUM_SAMPLES);
+        const float cosTheta = sqrt(1.0 - t);
+        const float sinTheta = sqrt(t);
+        const float phi = float(i) * GOLDEN_ANGLE;
+
+        const float scale = mix(0.1, 1.0, t * t);
+        const vec3 offset = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta) * scale * uRadius;
+
+        const vec3 samplePosition = position + TBN * offset;
+
+        const vec4 sampleClip = uProjection * vec4(samplePosition, 1.0);
+        const vec2 sampleUV = sampleClip.xy / sampleClip.w * 0.5 + 0.5;
+
+        const float sceneDepth = textureLod(uDepthTexture, sampleUV, 0.0).r;
+
+        // Fades out occluders well in front of the sample, they aren't close enough to matter
+        const float rangeCheck = smoothstep(0.0, 1.0, uRadius / abs(linearDepth - sceneDepth));
+
+        occlusion += (sceneDepth < -samplePosition.z - DEPTH_BIAS * linearDepth ? 1.0 : 0.0) * rangeCheck;
+    }
+
+    float ao = 1.0 - occlusion / float(NUM_SAMPLES);
+
+    // Reproject into last frame, rejecting the history where the depth doesn't match (disocclusion)
+    const vec4 worldPosition = uInverseView * vec4(position, 1.0);
+    const vec4 previousClip = uPreviousViewProjection * worldPosition;
+    const vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+
+    if (uHistoryValid && all(greaterThanEqual(previousUV, vec2(0.0))) && all(lessThanEqual(previousUV, vec2(1.0))))
+    {
+        const vec2 history = textureLod(uHistoryTexture, previousUV, 0.0).rg;
+
+        if (abs(history.g - previousClip.w) < 0.05 * previousClip.w) ao = mix(history.r, ao, uBlendFactor);
+    }
+
+    imageStore(uOutputImage, texel, vec4(ao, linearDepth, 0.0, 0.0));
+}
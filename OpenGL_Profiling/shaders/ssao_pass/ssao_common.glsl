@@ -0,0 +1,18 @@
+// Unjittered, the AO doesn't care about sub-pixel offsets
+uniform mat4 uProjection;
+
+// Hardware depth -> positive view space distance
+float linearizeDepth(float depth)
+{
+    const float ndcDepth = depth * 2.0 - 1.0;
+
+    return uProjection[3][2] / (ndcDepth + uProjection[2][2]);
+}
+
+// uv + positive view space distance -> view space position
+vec3 reconstructViewPosition(vec2 uv, float linearDepth)
+{
+    const vec2 ndc = uv * 2.0 - 1.0;
+
+    return vec3(ndc * linearDepth / vec2(uProjection[0][0], uProjection[1][1]), -linearDepth);
+}
@@ -0,0 +1,53 @@
+#version 460
+
+// Bilateral upsample of the half resolution AO. The light it occludes is subtracted from the HDR target by the blend state,
+// so only the ambient term the forward pass wrote out separately gets darkened
+uniform sampler2D uDepthTexture; // Full resolution hardware depth
+uniform sampler2D uAOTexture; // Half resolution AO + linear depth
+uniform sampler2D uAmbientTexture; // Full resolution ambient lighting
+uniform float uStrength;
+
+out vec4 vFragColour;
+
+#include "ssao_common.glsl"
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    const float linearDepth = linearizeDepth(texelFetch(uDepthTexture, texel, 0).r);
+
+    const ivec2 aoSize = textureSize(uAOTexture, 0);
+
+    // The 2x2 half resolution pixels around this one, half resolution pixel i was sampled at full resolution 2i
+    const vec2 aoPosition = vec2(texel) * 0.5;
+    const ivec2 base = ivec2(floor(aoPosition));
+    const vec2 f = aoPosition - vec2(base);
+
+    float ao = 0.0;
+    float totalWeight = 0.0;
+
+    for (int y = 0; y < 2; y++)
+    {
+        for (int x = 0; x < 2; x++)
+        {
+            const vec2 aoSample = texelFetch(uAOTexture, clamp(base + ivec2(x, y), ivec2(0), aoSize - 1), 0).rg;
+
+            const vec2 bilinear = mix(1.0 - f, f, vec2(x, y));
+
+            // Samples from another surface barely count, stops AO bleeding over silhouettes
+            const float depthWeight = 1.0 / (0.0001 + abs(aoSample.g - linearDepth) / linearDepth);
+
+            const float weight = bilinear.x * bilinear.y * depthWeight;
+
+            ao += aoSample.r * weight;
+            totalWeight += weight;
+        }
+    }
+
+    ao /= max(totalWeight, 0.0001);
+
+    const vec3 ambient = texelFetch(uAmbientTexture, texel, 0).rgb;
+
+    vFragColour = vec4(ambient * (1.0 - mix(1.0, ao, uStrength)), 0.0);
+}
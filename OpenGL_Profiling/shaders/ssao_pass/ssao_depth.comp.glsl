@@ -0,0 +1,22 @@
+#version 460
+
+// Full resolution hardware depth -> half resolution linear depth, the AO taps all read this instead
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uDepthTexture;
+
+layout (r32f, binding = 0) uniform writeonly image2D uOutputImage;
+
+#include "ssao_common.glsl"
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+
+    if (any(greaterThanEqual(texel, imageSize(uOutputImage)))) return;
+
+    // Top left of each 2x2, so the half resolution pixel centres line up with real samples
+    const ivec2 source = min(texel * 2, textureSize(uDepthTexture, 0) - 1);
+
+    imageStore(uOutputImage, texel, vec4(linearizeDepth(texelFetch(uDepthTexture, source, 0).r)));
+}
@@ -0,0 +1,173 @@
+#version 460
+
+// Temporal AA resolve, doubles as a temporal upsampler when the output is bigger than the render target.
+// The current frame is gathered from the 3x3 render pixels around each output pixel, weighted by where their
+// jittered samples actually landed. History is reprojected with the velocity buffer, then clipped to the
+// current neighbourhood's colour distribution (variance clipping in YCoCg) to stop ghosting
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D uCurrentTexture; // HDR target, at render size
+uniform sampler2D uVelocityTexture;
+uniform sampler2D uHistoryTexture; // Last frame's resolve, at output size, must be linearly filtered
+
+uniform vec2 uJitter; // Render pixels
+uniform float uBlendFactor; // Weight of the current frame
+uniform bool uHistoryValid;
+
+layout (rgba16f, binding = 0) uniform writeonly image2D uOutputImage;
+
+// Width of the clipping box, in standard deviations
+const float VARIANCE_CLIP_GAMMA = 1.25;
+
+float luminance(vec3 colour)
+{
+    return dot(colour, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// Blending in a tonemapped space stops single bright pixels from dominating (and flickering)
+vec3 toPerceptual(vec3 colour)
+{
+    return colour / (1.0 + luminance(colour));
+}
+
+vec3 fromPerceptual(vec3 colour)
+{
+    return colour / max(1.0 - luminance(colour), 0.0001);
+}
+
+vec3 RGBToYCoCg(vec3 colour)
+{
+    return vec3(
+        dot(colour, vec3(0.25, 0.5, 0.25)),
+        dot(colour, vec3(0.5, 0.0, -0.5)),
+        dot(colour, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 YCoCgToRGB(vec3 colour)
+{
+    return vec3(
+        colour.x + colour.y - colour.z,
+        colour.x + colour.z,
+        colour.x - colour.y - colour.z);
+}
+
+// Pulls the colour towards the box centre until it's inside, keeps the hue better than a per channel clamp
+vec3 clipToAABB(vec3 colour, vec3 minimum, vec3 maximum)
+{
+    const vec3 centre = 0.5 * (maximum + minimum);
+    const vec3 extents = 0.5 * (maximum - minimum) + 0.0001;
+
+    const vec3 offset = colour - centre;
+    const vec3 units = abs(offset / extents);
+    const float maxUnit = max(units.x, max(units.y, units.z));
+
+    return maxUnit > 1.0 ? centre + offset / maxUnit : colour;
+}
+
+// 5 tap Catmull-Rom, bilinear history sampling would soften the image a little more every frame
+vec3 sampleHistory(vec2 uv)
+{
+    const vec2 size = vec2(textureSize(uHistoryTexture, 0));
+
+    const vec2 samplePos = uv * size;
+    const vec2 texPos1 = floor(samplePos - 0.5) + 0.5;
+    const vec2 f = samplePos - texPos1;
+
+    const vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    const vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    const vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    const vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    // The middle two taps share one bilinear fetch
+    const vec2 w12 = w1 + w2;
+    const vec2 texPos0 = (texPos1 - 1.0) / size;
+    const vec2 texPos3 = (texPos1 + 2.0) / size;
+    const vec2 texPos12 = (texPos1 + w2 / w12) / size;
+
+    vec3 result = vec3(0.0);
+    result += textureLod(uHistoryTexture, vec2(texPos12.x, texPos0.y), 0.0).rgb * w12.x * w0.y;
+    result += textureLod(uHistoryTexture, vec2(texPos0.x, texPos12.y), 0.0).rgb * w0.x * w12.y;
+    result += textureLod(uHistoryTexture, vec2(texPos12.x, texPos12.y), 0.0).rgb * w12.x * w12.y;
+    result += textureLod(uHistoryTexture, vec2(texPos3.x, texPos12.y), 0.0).rgb * w3.x * w12.y;
+    result += textureLod(uHistoryTexture, vec2(texPos12.x, texPos3.y), 0.0).rgb * w12.x * w3.y;
+
+    const float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+
+    // The negative lobes can undershoot next to bright edges
+    return max(result / weight, vec3(0.0));
+}
+
+void main()
+{
+    const ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    const ivec2 outputSize = imageSize(uOutputImage);
+
+    if (any(greaterThanEqual(texel, outputSize))) return;
+
+    const vec2 uv = (vec2(texel) + 0.5) / vec2(outputSize);
+
+    const ivec2 inputSize = textureSize(uCurrentTexture, 0);
+
+    // This output pixel's position in render pixels. Render pixel i was sampled at i + 0.5 - jitter
+    const vec2 samplePos = uv * vec2(inputSize);
+    const ivec2 centre = ivec2(floor(samplePos + uJitter));
+
+    vec3 current = vec3(0.0);
+    float totalWeight = 0.0;
+    float closestWeight = 0.0;
+
+    vec3 moment1 = vec3(0.0);
+    vec3 moment2 = vec3(0.0);
+
+    // Longest motion in the neighbourhood, so edges of moving objects don't drag their background along
+    vec2 velocity = vec2(0.0);
+
+    for (int y = -1; y <= 1; y++)
+    {
+        for (int x = -1; x <= 1; x++)
+        {
+            const ivec2 neighbour = clamp(centre + ivec2(x, y), ivec2(0), inputSize - 1);
+
+            const vec3 colour = toPerceptual(texelFetch(uCurrentTexture, neighbour, 0).rgb);
+
+            // Gaussian fit to Blackman-Harris, by distance from where the sample landed
+            const vec2 offset = vec2(neighbour) + 0.5 - uJitter - samplePos;
+            const float weight = exp(-2.29 * dot(offset, offset));
+
+            current += colour * weight;
+            totalWeight += weight;
+            closestWeight = max(closestWeight, weight);
+
+            const vec3 yCoCg = RGBToYCoCg(colour);
+            moment1 += yCoCg;
+            moment2 += yCoCg * yCoCg;
+
+            const vec2 neighbourVelocity = texelFetch(uVelocityTexture, neighbour, 0).xy;
+            if (dot(neighbourVelocity, neighbourVelocity) > dot(velocity, velocity)) velocity = neighbourVelocity;
+        }
+    }
+
+    current /= totalWeight;
+
+    const vec2 historyUV = uv - velocity;
+
+    if (!uHistoryValid || any(lessThan(historyUV, vec2(0.0))) || any(greaterThan(historyUV, vec2(1.0))))
+    {
+        imageStore(uOutputImage, texel, vec4(fromPerceptual(current), 1.0));
+        return;
+    }
+
+    const vec3 mean = moment1 / 9.0;
+    const vec3 standardDeviation = sqrt(abs(moment2 / 9.0 - mean * mean));
+
+    vec3 history = RGBToYCoCg(toPerceptual(sampleHistory(historyUV)));
+    history = clipToAABB(history, mean - VARIANCE_CLIP_GAMMA * standardDeviation, mean + VARIANCE_CLIP_GAMMA * standardDeviation);
+    history = YCoCgToRGB(history);
+
+    // When upsampling, output pixels with no sample close by this frame lean harder on the history
+    const float alpha = uBlendFactor * closestWeight;
+
+    const vec3 resolved = mix(history, current, alpha);
+
+    imageStore(uOutputImage, texel, vec4(fromPerceptual(resolved), 1.0));
+}
@@ -1,29 +1,26 @@
 #define NUM_CASCADES 5
-
-layout (std140) uniform FlagsBuffer
-{
-    bool uNormalsEnabled;
-    bool uOcclusionEnabled;
-    bool uShadowsEnabled;
-    bool uEnvironmentMapEnabled;
-    bool uEmulateSunEnabled;
-    bool uDeferredPassEnabled;
-    bool uHDRPassEnabled;
-};
+#define NUM_SH_COEFFICIENTS 9
 
 layout(std140) uniform FrameUniformsBuffer
 {
     mat4 uProjectionMatrix;
     mat4 uViewMatrix;
+    mat4 uPreviousViewProjectionMatrix; // Unjittered
     vec3 uCameraPosition;
 
     vec4 uDirectionalShadowCascadePlanes;
 
-    float uPointShadowFarPlane;
     float uPointShadowNearPlane;
+    float uPointShadowFarPlane;
+
+    vec2 uJitter; // NDC offset baked into uProjectionMatrix
 
     int uNumPointLights;
     int uNumDirectionalLights;
+
+    int uPointShadowMode;
+
+    vec4 uIrradianceSH[NUM_SH_COEFFICIENTS]; // L2, cosine convolved and divided by pi. RGB + padding
 };
 
 struct PointLight
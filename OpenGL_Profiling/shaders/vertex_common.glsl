@@ -9,10 +9,17 @@ layout(std430) buffer JointsBuffer
     mat4 bJointMatrices[];
 };
 
+// Last frame's skinning, for motion vectors
+layout(std430) buffer PreviousJointsBuffer
+{
+    mat4 bPreviousJointMatrices[];
+};
+
 layout (std140) uniform ObjectBuffer
 {
     mat4 uModelMatrix;
     mat3 uNormalMatrix;
+    mat4 uPreviousModelMatrix;
 };
 
 struct SkinnedVertex
@@ -40,3 +47,21 @@ SkinnedVertex applySkinning(vec3 position, vec3 normal, vec4 boneIds, vec4 boneW
 
     return SkinnedVertex(transformedPosition, transformedNormal);
 }
+
+// Position only version of applySkinning with last frame's joints
+vec3 applyPreviousSkinning(vec3 position, vec4 boneIds, vec4 boneWeights)
+{
+    vec3 transformedPosition = vec3(0);
+
+    for (int i = 0; i < 4; i++)
+    {
+        transformedPosition += boneWeights[i] * (bPreviousJointMatrices[int(boneIds[i])] * vec4(position, 1.0)).xyz;
+    }
+
+    if (transformedPosition == vec3(0.0) || boneWeights.w > boneWeights.x)
+    {
+        transformedPosition = position;
+    }
+
+    return transformedPosition;
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "animationController.h"
+#include "cpuProfiler.h"
 
 #include <spdlog/spdlog.h>
 
@@ -23,6 +24,8 @@ AnimationController::AnimationController(std::shared_ptr<RenderableModel> model)
 
 void AnimationController::advance(float dt)
 {
+	PROFILE_SCOPE("AnimationController::advance");
+
 	if (!inTransition && currentAnimation == "") return;
 
 	if (inTransition)
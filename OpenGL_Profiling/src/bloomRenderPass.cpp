@@ -0,0 +1,107 @@
+#include "bloomRenderPass.h"
+
+#include <format>
+
+constexpr int MAX_BLOOM_MIPS = 6;
+
+// No point going below this, there's nothing left to blur
+constexpr int MIN_BLOOM_MIP_DIMENSIONS = 8;
+
+BloomRenderPass::BloomRenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext), bloomTexture(0), mipDimensions(), filterRadius(1.0f)
+{
+	downsampleShader.addShader(GL_COMPUTE_SHADER, "shaders/bloom_pass/bloom_downsample.comp.glsl");
+	upsampleShader.addShader(GL_COMPUTE_SHADER, "shaders/bloom_pass/bloom_upsample.comp.glsl");
+
+	allocateMipChain();
+}
+
+void BloomRenderPass::frame()
+{
+	PROFILE_SCOPE("BloomRenderPass::frame");
+
+	glActiveTexture(GL_TEXTURE0);
+
+	// Downsample, the first one reads straight from the HDR target (or its TAA resolve)
+	downsampleShader.use();
+	downsampleShader.setInt("uSourceTexture", 0);
+
+	for (int mip = 0; mip < getNumMips(); mip++)
+	{
+		ScopedGPUProfile scope(renderContext.gpuProfiler, std::format("Downsample {}", mip));
+
+		if (mip == 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, renderContext.sceneColour);
+			downsampleShader.setInt("uSourceLevel", 0);
+		}
+		else
+		{
+			glBindTexture(GL_TEXTURE_2D, bloomTexture);
+			downsampleShader.setInt("uSourceLevel", mip - 1);
+		}
+
+		downsampleShader.setBool("uKarisAverage", mip == 0);
+
+		glBindImageTexture(0, bloomTexture, mip, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+		glDispatchCompute((mipDimensions[mip].x + 7) / 8, (mipDimensions[mip].y + 7) / 8, 1);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+
+	// Upsample back up the chain, each mip blurs into the one above it
+	upsampleShader.use();
+	upsampleShader.setInt("uSourceTexture", 0);
+	upsampleShader.setFloat("uFilterRadius", filterRadius);
+
+	glBindTexture(GL_TEXTURE_2D, bloomTexture);
+
+	for (int mip = getNumMips() - 1; mip > 0; mip--)
+	{
+		ScopedGPUProfile scope(renderContext.gpuProfiler, std::format("Upsample {}", mip));
+
+		upsampleShader.setInt("uSourceLevel", mip);
+
+		glBindImageTexture(0, bloomTexture, mip - 1, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+
+		glDispatchCompute((mipDimensions[mip - 1].x + 7) / 8, (mipDimensions[mip - 1].y + 7) / 8, 1);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+}
+
+void BloomRenderPass::refresh()
+{
+	allocateMipChain();
+}
+
+void BloomRenderPass::allocateMipChain()
+{
+	mipDimensions.clear();
+
+	glm::ivec2 dimensions = glm::max(renderContext.dimensions / 2, glm::ivec2(1));
+	while (static_cast<int>(mipDimensions.size()) < MAX_BLOOM_MIPS &&
+		(mipDimensions.empty() || glm::min(dimensions.x, dimensions.y) >= MIN_BLOOM_MIP_DIMENSIONS))
+	{
+		mipDimensions.push_back(dimensions);
+		dimensions = glm::max(dimensions / 2, glm::ivec2(1));
+	}
+
+	// Needs a fresh texture, immutable storage can't be resized
+	glDeleteTextures(1, &bloomTexture);
+	glGenTextures(1, &bloomTexture);
+
+	// Owned by the context so the HDR pass can find it, the renderer cleans it up
+	renderContext.textures["bloom"] = bloomTexture;
+
+	glBindTexture(GL_TEXTURE_2D, bloomTexture);
+	glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(mipDimensions.size()), GL_RGBA16F, mipDimensions[0].x, mipDimensions[0].y);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
\ No newline at end of file
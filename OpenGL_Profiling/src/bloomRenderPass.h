@@ -0,0 +1,37 @@
+#pragma once
+
+#include "renderPass.h"
+
+// Progressive downsample / upsample bloom on the HDR target, the result ends up in the "bloom" texture.
+// Each step is its own GPU profiler scope, "Downsample N" into mip N and "Upsample N" out of it
+class BloomRenderPass : public RenderPass
+{
+public:
+	BloomRenderPass(RenderContext& renderContext);
+
+	BloomRenderPass(const BloomRenderPass&) = delete;
+	BloomRenderPass& operator=(const BloomRenderPass&) = delete;
+
+public:
+	void frame() override;
+	void refresh() override;
+
+	float getFilterRadius() const { return filterRadius; }
+	void setFilterRadius(float filterRadius) { this->filterRadius = filterRadius; }
+
+	int getNumMips() const { return static_cast<int>(mipDimensions.size()); }
+	glm::ivec2 getMipDimensions(int mip) const { return mipDimensions[mip]; }
+
+private:
+	void allocateMipChain();
+
+private:
+	ShaderProgram downsampleShader;
+	ShaderProgram upsampleShader;
+
+	GLuint bloomTexture; // Half resolution, one level per mip
+
+	std::vector<glm::ivec2> mipDimensions;
+
+	float filterRadius;
+};
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "characterController.h"
+#include "cpuProfiler.h"
 
 #include <GLFW/glfw3.h>
 
@@ -80,6 +81,8 @@ CharacterController::CharacterController(InputHandler& inputHandler, glm::vec3 s
 
 void CharacterController::update(Timer::f_seconds dT)
 {
+	PROFILE_SCOPE("CharacterController::update");
+
 	const float deltaTime = dT.count() / 1.0f;
 
 	if (input.getAction("orbit"))
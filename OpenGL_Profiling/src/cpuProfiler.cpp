@@ -0,0 +1,239 @@
+#include "cpuProfiler.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+
+namespace
+{
+	uint64_t now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// Zone names are literals, but a quote or backslash would still break the file
+	std::string escapeJSON(const char* string)
+	{
+		std::string escaped;
+		for (const char* c = string; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') escaped += '\\';
+			escaped += *c;
+		}
+
+		return escaped;
+	}
+}
+
+void CPUProfiler::ThreadBuffer::push(const Event& event)
+{
+	const size_t write = writeIndex.load(std::memory_order_relaxed);
+
+	// Full, the main thread hasn't drained for a while. Dropping is fine, depths keep the rest paired
+	if (write - readIndex.load(std::memory_order_acquire) >= CAPACITY) return;
+
+	events[write % CAPACITY] = event;
+	writeIndex.store(write + 1, std::memory_order_release);
+}
+
+void CPUProfiler::setEnabled(bool enabled)
+{
+	CPUProfiler::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void CPUProfiler::setThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+
+	std::lock_guard lock(threadsMutex);
+	buffer.name = name;
+	threadNames[buffer.thread] = name;
+}
+
+CPUProfiler::ThreadBuffer& CPUProfiler::getThreadBuffer()
+{
+	thread_local std::shared_ptr<ThreadBuffer> buffer = []()
+		{
+			std::lock_guard lock(threadsMutex);
+
+			// Short lived threads would otherwise each leave a ring and a name behind, so the registry only
+			// grows to the most threads alive at once. A trace can show an exited thread under its successor's name
+			std::shared_ptr<ThreadBuffer> buffer;
+			if (!freeBuffers.empty())
+			{
+				buffer = std::move(freeBuffers.back());
+				freeBuffers.pop_back();
+
+				buffer->depth = 0;
+				buffer->open.clear();
+			}
+			else
+			{
+				buffer = std::make_shared<ThreadBuffer>();
+				buffer->thread = static_cast<uint32_t>(threadNames.size());
+				threadNames.emplace_back();
+			}
+
+			buffer->name = std::format("Thread {}", buffer->thread);
+			threadNames[buffer->thread] = buffer->name;
+
+			threads.push_back(buffer);
+
+			return buffer;
+		}();
+
+	return *buffer;
+}
+
+void CPUProfiler::beginZone(const char* name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	buffer.push({ name, now(), buffer.depth++ });
+}
+
+void CPUProfiler::endZone()
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	buffer.push({ nullptr, now(), --buffer.depth });
+}
+
+void CPUProfiler::drain(ThreadBuffer& buffer, std::vector<Zone>& zones)
+{
+	const size_t write = buffer.writeIndex.load(std::memory_order_acquire);
+	size_t read = buffer.readIndex.load(std::memory_order_relaxed);
+
+	for (; read < write; read++)
+	{
+		const Event& event = buffer.events[read % ThreadBuffer::CAPACITY];
+
+		if (event.name)
+		{
+			buffer.open.push_back(event);
+			continue;
+		}
+
+		// Anything deeper lost its end
+		while (!buffer.open.empty() && buffer.open.back().depth > event.depth) buffer.open.pop_back();
+
+		// Otherwise it lost its begin
+		if (buffer.open.empty() || buffer.open.back().depth != event.depth) continue;
+
+		const Event& begin = buffer.open.back();
+		zones.push_back({ begin.name, buffer.thread, begin.depth, begin.timestamp, event.timestamp });
+
+		buffer.open.pop_back();
+	}
+
+	buffer.readIndex.store(read, std::memory_order_release);
+}
+
+void CPUProfiler::endFrame()
+{
+	latestFrame.clear();
+
+	{
+		std::lock_guard lock(threadsMutex);
+
+		for (const auto& buffer : threads)
+		{
+			drain(*buffer, latestFrame);
+		}
+
+		// Only the list holds the buffers of exited threads, once drained they're free for the next new thread
+		const auto exited = std::stable_partition(threads.begin(), threads.end(), [](const auto& buffer)
+			{
+				return buffer.use_count() > 1 ||
+					buffer->readIndex.load(std::memory_order_relaxed) != buffer->writeIndex.load(std::memory_order_relaxed);
+			});
+
+		freeBuffers.insert(freeBuffers.end(), std::make_move_iterator(exited), std::make_move_iterator(threads.end()));
+		threads.erase(exited, threads.end());
+	}
+
+	std::sort(latestFrame.begin(), latestFrame.end(), [](const Zone& a, const Zone& b)
+		{
+			return a.thread != b.thread ? a.thread < b.thread : a.start < b.start;
+		});
+
+	if (captureFramesLeft > 0)
+	{
+		captured.insert(captured.end(), latestFrame.begin(), latestFrame.end());
+
+		if (--captureFramesLeft == 0)
+		{
+			setEnabled(enabledBeforeCapture);
+
+			if (writeTrace(capturePath)) spdlog::info("Wrote CPU trace: {}", capturePath.string());
+
+			captured.clear();
+		}
+	}
+}
+
+std::vector<std::string> CPUProfiler::getThreadNames()
+{
+	std::lock_guard lock(threadsMutex);
+
+	return threadNames;
+}
+
+void CPUProfiler::capture(int numFrames, const std::filesystem::path& path)
+{
+	if (numFrames <= 0 || isCapturing()) return;
+
+	enabledBeforeCapture = isEnabled();
+	setEnabled(true);
+
+	captureFramesLeft = numFrames;
+	capturePath = path;
+	captured.clear();
+}
+
+bool CPUProfiler::writeTrace(const std::filesystem::path& path)
+{
+	std::error_code error;
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		spdlog::warn("Failed to write CPU trace: {}", path.string());
+		return false;
+	}
+
+	uint64_t origin = UINT64_MAX;
+	for (const auto& zone : captured) origin = std::min(origin, zone.start);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	const auto writeEvent = [&](const std::string& event)
+		{
+			file << (first ? "\n" : ",\n") << event;
+			first = false;
+		};
+
+	// Thread names first, as metadata events
+	const std::vector<std::string> names = getThreadNames();
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		writeEvent(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+			i, escapeJSON(names[i].c_str())));
+	}
+
+	// Complete events, microseconds
+	for (const auto& zone : captured)
+	{
+		writeEvent(std::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+			escapeJSON(zone.name), zone.thread,
+			static_cast<double>(zone.start - origin) / 1000.0, static_cast<double>(zone.end - zone.start) / 1000.0));
+	}
+
+	file << "\n]}\n";
+
+	return static_cast<bool>(file);
+}
\ No newline at end of file
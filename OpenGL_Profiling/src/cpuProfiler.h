@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times the enclosing block on whichever thread runs it. name must be a string literal, only the pointer is kept
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+// CPU time split into nested zones, from any thread. Each thread records begin / end events into a
+// lock free ring of its own, the main thread drains them all in endFrame and pairs them back into zones.
+// Frames can be captured and written out as Chrome Trace Event JSON, for chrome://tracing or Perfetto.
+// All static, there's one per process
+class CPUProfiler
+{
+public:
+	struct Zone
+	{
+		const char* name;
+		uint32_t thread; // Index into getThreadNames
+		int depth; // Within its thread
+
+		// Nanoseconds, steady clock
+		uint64_t start;
+		uint64_t end;
+
+		float getMilliseconds() const { return static_cast<float>(end - start) / 1000000.0f; }
+	};
+
+public:
+	// Disabled, PROFILE_SCOPE costs one branch
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+	static void setEnabled(bool enabled);
+
+	// Shown in traces, the calling thread's
+	static void setThreadName(const std::string& name);
+
+	// Main thread, once a frame
+	static void endFrame();
+
+	// Zones that finished during the last frame, ordered by thread then start
+	static const std::vector<Zone>& getLatestFrame() { return latestFrame; }
+
+	static std::vector<std::string> getThreadNames();
+
+	// Records the next numFrames frames (enabling the profiler meanwhile) then writes the trace
+	static void capture(int numFrames, const std::filesystem::path& path);
+	static bool isCapturing() { return captureFramesLeft > 0; }
+
+	// For ProfileZone
+	static void beginZone(const char* name);
+	static void endZone();
+
+private:
+	struct Event
+	{
+		const char* name; // Null for an end
+		uint64_t timestamp;
+		int depth; // Begin and end of a zone share it, so a dropped one can't mismatch the rest
+	};
+
+	// Single producer (its thread), single consumer (the main thread)
+	struct ThreadBuffer
+	{
+		static constexpr size_t CAPACITY = 1 << 16;
+
+		std::unique_ptr<Event[]> events = std::make_unique<Event[]>(CAPACITY);
+		std::atomic<size_t> writeIndex = 0;
+		std::atomic<size_t> readIndex = 0;
+
+		// Producer only
+		int depth = 0;
+
+		// Consumer only, zones begun but not ended yet
+		std::vector<Event> open;
+
+		uint32_t thread = 0;
+		std::string name;
+
+		void push(const Event& event);
+	};
+
+	static ThreadBuffer& getThreadBuffer();
+
+	static void drain(ThreadBuffer& buffer, std::vector<Zone>& zones);
+
+	static bool writeTrace(const std::filesystem::path& path);
+
+private:
+	static inline std::atomic<bool> enabled = false;
+
+	static inline std::mutex threadsMutex;
+	static inline std::vector<std::shared_ptr<ThreadBuffer>> threads; // Kept after their thread exits until drained
+	static inline std::vector<std::shared_ptr<ThreadBuffer>> freeBuffers; // Of exited threads, reused with their slot by new ones
+	static inline std::vector<std::string> threadNames;
+
+	static inline std::vector<Zone> latestFrame;
+
+	static inline int captureFramesLeft = 0;
+	static inline bool enabledBeforeCapture = false;
+	static inline std::filesystem::path capturePath;
+	static inline std::vector<Zone> captured;
+};
+
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name)
+		: active(CPUProfiler::isEnabled())
+	{
+		if (active) CPUProfiler::beginZone(name);
+	}
+
+	~ProfileZone()
+	{
+		if (active) CPUProfiler::endZone();
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const bool active;
+};
\ No newline at end of file
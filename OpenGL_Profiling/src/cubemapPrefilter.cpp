@@ -0,0 +1,31 @@
+#include "cubemapPrefilter.h"
+
+CubemapPrefilter::CubemapPrefilter()
+{
+	prefilterShader.addShader(GL_COMPUTE_SHADER, "shaders/environment_pass/prefilter.comp.glsl");
+}
+
+void CubemapPrefilter::prefilter(GLuint source, GLuint target, int targetDimensions, int numMips)
+{
+	for (int mip = 0; mip < numMips; mip++)
+	{
+		prefilterMip(source, target, targetDimensions, mip, numMips);
+	}
+}
+
+void CubemapPrefilter::prefilterMip(GLuint source, GLuint target, int targetDimensions, int mip, int numMips)
+{
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, source);
+
+	prefilterShader.use();
+	prefilterShader.setInt("uEnvironmentMap", 0);
+	prefilterShader.setFloat("uRoughness", static_cast<float>(mip) / static_cast<float>(numMips - 1));
+
+	glBindImageTexture(0, target, mip, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	const int mipDimensions = targetDimensions >> mip;
+	glDispatchCompute((mipDimensions + 7) / 8, (mipDimensions + 7) / 8, 6);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+}
\ No newline at end of file
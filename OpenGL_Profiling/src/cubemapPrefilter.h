@@ -0,0 +1,24 @@
+#pragma once
+
+#include "shaderProgram.h"
+
+// GGX prefiltering for the split sum specular, shared by the environment and the reflection probes.
+// Source and target are RGBA16F cubemaps (or cube views of an array), the source fully mipped.
+// Target mip m gets roughness m / (numMips - 1), one compute dispatch per mip writes all six faces
+class CubemapPrefilter
+{
+public:
+	CubemapPrefilter();
+
+	CubemapPrefilter(const CubemapPrefilter&) = delete;
+	CubemapPrefilter& operator=(const CubemapPrefilter&) = delete;
+
+public:
+	void prefilter(GLuint source, GLuint target, int targetDimensions, int numMips);
+
+	// For spreading the work over frames
+	void prefilterMip(GLuint source, GLuint target, int targetDimensions, int mip, int numMips);
+
+private:
+	ShaderProgram prefilterShader;
+};
\ No newline at end of file
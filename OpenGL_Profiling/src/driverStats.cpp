@@ -0,0 +1,311 @@
+#include "driverStats.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+namespace
+{
+	// The driver's entry points, from before install
+	PFNGLDRAWARRAYSPROC driverDrawArrays = nullptr;
+	PFNGLDRAWELEMENTSPROC driverDrawElements = nullptr;
+	PFNGLDRAWELEMENTSINSTANCEDPROC driverDrawElementsInstanced = nullptr;
+	PFNGLDISPATCHCOMPUTEPROC driverDispatchCompute = nullptr;
+	PFNGLUSEPROGRAMPROC driverUseProgram = nullptr;
+	PFNGLBINDTEXTUREPROC driverBindTexture = nullptr;
+	PFNGLBINDIMAGETEXTUREPROC driverBindImageTexture = nullptr;
+	PFNGLBINDBUFFERPROC driverBindBuffer = nullptr;
+	PFNGLBINDBUFFERBASEPROC driverBindBufferBase = nullptr;
+	PFNGLBINDFRAMEBUFFERPROC driverBindFramebuffer = nullptr;
+	PFNGLBUFFERDATAPROC driverBufferData = nullptr;
+	PFNGLBUFFERSUBDATAPROC driverBufferSubData = nullptr;
+	PFNGLTEXIMAGE2DPROC driverTexImage2D = nullptr;
+	PFNGLTEXIMAGE3DPROC driverTexImage3D = nullptr;
+	PFNGLTEXTURESUBIMAGE2DPROC driverTextureSubImage2D = nullptr;
+	PFNGLTEXTURESUBIMAGE3DPROC driverTextureSubImage3D = nullptr;
+
+	// For telling switches from rebinding what's already bound
+	GLuint boundProgram = 0;
+	GLuint boundDrawFramebuffer = 0;
+
+	uint64_t getNumPrimitives(GLenum mode, GLsizei count)
+	{
+		if (count <= 0) return 0;
+
+		switch (mode)
+		{
+		case GL_POINTS: return count;
+		case GL_LINES: return count / 2;
+		case GL_LINE_STRIP: return count - 1;
+		case GL_LINE_LOOP: return count;
+		case GL_TRIANGLES: return count / 3;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN: return count >= 3 ? count - 2 : 0;
+		case GL_PATCHES: return count;
+		default: return 0;
+		}
+	}
+
+	bool isTriangleMode(GLenum mode)
+	{
+		return mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN;
+	}
+
+	void countDraw(GLenum mode, GLsizei count, GLsizei instances)
+	{
+		DriverCounters& counters = DriverStats::getCounters();
+
+		const uint64_t primitives = getNumPrimitives(mode, count) * static_cast<uint64_t>(std::max(instances, 0));
+
+		counters.drawCalls++;
+		counters.primitives += primitives;
+		if (isTriangleMode(mode)) counters.triangles += primitives;
+	}
+
+	// Bytes per pixel of client side pixel data
+	uint64_t getPixelBytes(GLenum format, GLenum type)
+	{
+		// Packed types hold the whole pixel
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE_3_3_2:
+		case GL_UNSIGNED_BYTE_2_3_3_REV:
+			return 1;
+		case GL_UNSIGNED_SHORT_5_6_5:
+		case GL_UNSIGNED_SHORT_5_6_5_REV:
+		case GL_UNSIGNED_SHORT_4_4_4_4:
+		case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+		case GL_UNSIGNED_SHORT_5_5_5_1:
+		case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+			return 2;
+		case GL_UNSIGNED_INT_8_8_8_8:
+		case GL_UNSIGNED_INT_8_8_8_8_REV:
+		case GL_UNSIGNED_INT_10_10_10_2:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_10F_11F_11F_REV:
+		case GL_UNSIGNED_INT_5_9_9_9_REV:
+		case GL_UNSIGNED_INT_24_8:
+			return 4;
+		case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+			return 8;
+		}
+
+		uint64_t componentBytes = 1;
+
+		switch (type)
+		{
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			componentBytes = 2;
+			break;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			componentBytes = 4;
+			break;
+		}
+
+		switch (format)
+		{
+		case GL_RG:
+		case GL_RG_INTEGER:
+		case GL_DEPTH_STENCIL:
+			return componentBytes * 2;
+		case GL_RGB:
+		case GL_BGR:
+		case GL_RGB_INTEGER:
+		case GL_BGR_INTEGER:
+			return componentBytes * 3;
+		case GL_RGBA:
+		case GL_BGRA:
+		case GL_RGBA_INTEGER:
+		case GL_BGRA_INTEGER:
+			return componentBytes * 4;
+		default:
+			return componentBytes;
+		}
+	}
+
+	void countTextureUpload(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+	{
+		// Null is an allocation, nothing crosses the bus
+		if (!pixels || width <= 0 || height <= 0 || depth <= 0) return;
+
+		DriverStats::getCounters().bytesUploaded +=
+			static_cast<uint64_t>(width) * static_cast<uint64_t>(height) * static_cast<uint64_t>(depth) * getPixelBytes(format, type);
+	}
+
+	void GLAPIENTRY countedDrawArrays(GLenum mode, GLint first, GLsizei count)
+	{
+		countDraw(mode, count, 1);
+		driverDrawArrays(mode, first, count);
+	}
+
+	void GLAPIENTRY countedDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+	{
+		countDraw(mode, count, 1);
+		driverDrawElements(mode, count, type, indices);
+	}
+
+	void GLAPIENTRY countedDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancecount)
+	{
+		countDraw(mode, count, instancecount);
+		driverDrawElementsInstanced(mode, count, type, indices, instancecount);
+	}
+
+	void GLAPIENTRY countedDispatchCompute(GLuint x, GLuint y, GLuint z)
+	{
+		DriverStats::getCounters().dispatches++;
+		driverDispatchCompute(x, y, z);
+	}
+
+	void GLAPIENTRY countedUseProgram(GLuint program)
+	{
+		if (program != boundProgram) DriverStats::getCounters().programSwitches++;
+		boundProgram = program;
+
+		driverUseProgram(program);
+	}
+
+	void GLAPIENTRY countedBindTexture(GLenum target, GLuint texture)
+	{
+		DriverStats::getCounters().textureBinds++;
+		driverBindTexture(target, texture);
+	}
+
+	void GLAPIENTRY countedBindImageTexture(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format)
+	{
+		DriverStats::getCounters().textureBinds++;
+		driverBindImageTexture(unit, texture, level, layered, layer, access, format);
+	}
+
+	void GLAPIENTRY countedBindBuffer(GLenum target, GLuint buffer)
+	{
+		DriverStats::getCounters().bufferBinds++;
+		driverBindBuffer(target, buffer);
+	}
+
+	void GLAPIENTRY countedBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+	{
+		DriverStats::getCounters().bufferBinds++;
+		driverBindBufferBase(target, index, buffer);
+	}
+
+	void GLAPIENTRY countedBindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		if (target != GL_READ_FRAMEBUFFER)
+		{
+			if (framebuffer != boundDrawFramebuffer) DriverStats::getCounters().framebufferSwitches++;
+			boundDrawFramebuffer = framebuffer;
+		}
+
+		driverBindFramebuffer(target, framebuffer);
+	}
+
+	void GLAPIENTRY countedBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+	{
+		if (data && size > 0) DriverStats::getCounters().bytesUploaded += static_cast<uint64_t>(size);
+		driverBufferData(target, size, data, usage);
+	}
+
+	void GLAPIENTRY countedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		if (data && size > 0) DriverStats::getCounters().bytesUploaded += static_cast<uint64_t>(size);
+		driverBufferSubData(target, offset, size, data);
+	}
+
+	void GLAPIENTRY countedTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+		GLenum format, GLenum type, const void* pixels)
+	{
+		countTextureUpload(width, height, 1, format, type, pixels);
+		driverTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	}
+
+	void GLAPIENTRY countedTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+		GLint border, GLenum format, GLenum type, const void* pixels)
+	{
+		countTextureUpload(width, height, depth, format, type, pixels);
+		driverTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	}
+
+	void GLAPIENTRY countedTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+		GLenum format, GLenum type, const void* pixels)
+	{
+		countTextureUpload(width, height, 1, format, type, pixels);
+		driverTextureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type, pixels);
+	}
+
+	void GLAPIENTRY countedTextureSubImage3D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+		GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+	{
+		countTextureUpload(width, height, depth, format, type, pixels);
+		driverTextureSubImage3D(texture, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+	}
+}
+
+DriverCounters& DriverCounters::operator+=(const DriverCounters& other)
+{
+	drawCalls += other.drawCalls;
+	dispatches += other.dispatches;
+	primitives += other.primitives;
+	triangles += other.triangles;
+	programSwitches += other.programSwitches;
+	textureBinds += other.textureBinds;
+	bufferBinds += other.bufferBinds;
+	framebufferSwitches += other.framebufferSwitches;
+	bytesUploaded += other.bytesUploaded;
+
+	return *this;
+}
+
+// Keeps the driver's entry point and puts the wrapper in its place
+#define INSTALL_COUNTED(name) driver##name = glad_gl##name; glad_gl##name = counted##name
+
+void DriverStats::install()
+{
+	if (installed) return;
+
+	INSTALL_COUNTED(DrawArrays);
+	INSTALL_COUNTED(DrawElements);
+	INSTALL_COUNTED(DrawElementsInstanced);
+	INSTALL_COUNTED(DispatchCompute);
+	INSTALL_COUNTED(UseProgram);
+	INSTALL_COUNTED(BindTexture);
+	INSTALL_COUNTED(BindImageTexture);
+	INSTALL_COUNTED(BindBuffer);
+	INSTALL_COUNTED(BindBufferBase);
+	INSTALL_COUNTED(BindFramebuffer);
+	INSTALL_COUNTED(BufferData);
+	INSTALL_COUNTED(BufferSubData);
+	INSTALL_COUNTED(TexImage2D);
+	INSTALL_COUNTED(TexImage3D);
+	INSTALL_COUNTED(TextureSubImage2D);
+	INSTALL_COUNTED(TextureSubImage3D);
+
+	installed = true;
+}
+
+#undef INSTALL_COUNTED
+
+void DriverStats::beginFrame()
+{
+	endPass();
+
+	latestFrame = std::move(currentFrame);
+	latestFrame.push_back({ "Other", other });
+
+	currentFrame.clear();
+	other = {};
+}
+
+void DriverStats::beginPass(const std::string& name)
+{
+	currentFrame.push_back({ name, {} });
+	currentPass = static_cast<int>(currentFrame.size()) - 1;
+}
+
+void DriverStats::endPass()
+{
+	currentPass = -1;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a pass asked of the driver in a frame
+struct DriverCounters
+{
+	uint32_t drawCalls = 0;
+	uint32_t dispatches = 0;
+
+	uint64_t primitives = 0; // Points, lines and triangles, instances included
+	uint64_t triangles = 0;
+
+	uint32_t programSwitches = 0; // glUseProgram with a different program
+	uint32_t textureBinds = 0; // glBindTexture and glBindImageTexture
+	uint32_t bufferBinds = 0; // glBindBuffer and glBindBufferBase
+	uint32_t framebufferSwitches = 0; // glBindFramebuffer with a different draw framebuffer
+
+	uint64_t bytesUploaded = 0; // glBufferData, glBufferSubData, glTexImage*, glTextureSubImage*, from client memory
+
+	DriverCounters& operator+=(const DriverCounters& other);
+};
+
+// GL call counts per render pass. install swaps GLAD's function pointers for the calls the renderer makes
+// with counting wrappers that forward to the driver, so call sites stay plain GL.
+// GL is only used from the main thread, so neither are these. All static, there's one per process
+class DriverStats
+{
+public:
+	struct Pass
+	{
+		std::string name;
+		DriverCounters counters;
+	};
+
+public:
+	// After GLAD has loaded, before anything is counted
+	static void install();
+	static bool isInstalled() { return installed; }
+
+	// Publishes the frame so far as the latest and starts the next
+	static void beginFrame();
+
+	// Calls between these count towards the pass, passes don't nest
+	static void beginPass(const std::string& name);
+	static void endPass();
+
+	// Passes in the order they ran, then "Other" for calls made outside them (UI, loading, ...)
+	static const std::vector<Pass>& getLatestFrame() { return latestFrame; }
+
+	// Where the wrappers count to
+	static DriverCounters& getCounters() { return currentPass >= 0 ? currentFrame[currentPass].counters : other; }
+
+private:
+	static inline bool installed = false;
+
+	static inline std::vector<Pass> currentFrame;
+	static inline int currentPass = -1;
+	static inline DriverCounters other;
+
+	static inline std::vector<Pass> latestFrame;
+};
+
+// Counts the enclosing block as a pass
+class ScopedDriverStats
+{
+public:
+	explicit ScopedDriverStats(const std::string& name) { DriverStats::beginPass(name); }
+	~ScopedDriverStats() { DriverStats::endPass(); }
+
+	ScopedDriverStats(const ScopedDriverStats&) = delete;
+	ScopedDriverStats& operator=(const ScopedDriverStats&) = delete;
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "dynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float SCALE_STEP = 0.05f;
+
+// Timer results lag a few frames, give a change time to show up before judging it
+constexpr int CHANGE_COOLDOWN_FRAMES = 30;
+
+// Only scale up once there's this much headroom, stops it oscillating around the target
+constexpr float UPSCALE_HEADROOM = 0.85f;
+
+constexpr float FRAME_TIME_SMOOTHING = 0.1f;
+
+DynamicResolution::DynamicResolution()
+	: enabled(false), targetMilliseconds(16.6f), minScale(0.5f),
+	scale(1.0f), smoothedMilliseconds(0.0f), framesSinceChange(0)
+{ }
+
+void DynamicResolution::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+
+	scale = 1.0f;
+	smoothedMilliseconds = 0.0f;
+	framesSinceChange = 0;
+}
+
+bool DynamicResolution::update(float gpuMilliseconds)
+{
+	if (!enabled || gpuMilliseconds <= 0.0f) return false;
+
+	smoothedMilliseconds = smoothedMilliseconds > 0.0f ?
+		smoothedMilliseconds + (gpuMilliseconds - smoothedMilliseconds) * FRAME_TIME_SMOOTHING :
+		gpuMilliseconds;
+
+	if (++framesSinceChange < CHANGE_COOLDOWN_FRAMES) return false;
+
+	const bool overBudget = smoothedMilliseconds > targetMilliseconds;
+	const bool underBudget = smoothedMilliseconds < targetMilliseconds * UPSCALE_HEADROOM;
+
+	if (!overBudget && !underBudget) return false;
+
+	// Cost is roughly proportional to pixel count, so scale each axis by the square root
+	const float idealScale = scale * std::sqrt(targetMilliseconds / smoothedMilliseconds);
+
+	float newScale = std::round(idealScale / SCALE_STEP) * SCALE_STEP;
+	newScale = std::clamp(newScale, minScale, 1.0f);
+
+	if (std::abs(newScale - scale) < SCALE_STEP * 0.5f) return false;
+
+	scale = newScale;
+	framesSinceChange = 0;
+
+	// The old average was measured at the old resolution
+	smoothedMilliseconds = 0.0f;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+// Picks a render scale that keeps the GPU frame time under a target budget.
+// The scale moves in coarse steps with a cooldown, as every change reallocates the render targets
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+
+public:
+	// Feed the latest GPU frame time, returns true when the scale changed
+	bool update(float gpuMilliseconds);
+
+	float getScale() const { return enabled ? scale : 1.0f; }
+
+	bool getEnabled() const { return enabled; }
+	void setEnabled(bool enabled);
+
+	float getTargetMilliseconds() const { return targetMilliseconds; }
+	void setTargetMilliseconds(float targetMilliseconds) { this->targetMilliseconds = targetMilliseconds; }
+
+	float getMinScale() const { return minScale; }
+	void setMinScale(float minScale) { this->minScale = minScale; }
+
+	float getSmoothedMilliseconds() const { return smoothedMilliseconds; }
+
+private:
+	bool enabled;
+
+	float targetMilliseconds;
+	float minScale;
+
+	float scale;
+	float smoothedMilliseconds;
+
+	int framesSinceChange;
+};
\ No newline at end of file
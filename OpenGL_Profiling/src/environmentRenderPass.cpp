@@ -0,0 +1,426 @@
+#include "environmentRenderPass.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <stb_image.h>
+
+#include <cstring>
+
+constexpr int ENVIRONMENT_MAP_DIMENSIONS = 1024;
+constexpr int PREFILTERED_MAP_DIMENSIONS = 256;
+constexpr int PREFILTERED_MAP_MIPS = 5; // Roughness 0, 0.25 ... 1, the forward shader's MAX_REFLECTION_LOD is this - 1
+constexpr int BRDF_LUT_DIMENSIONS = 512;
+
+// Bump whenever the filtering shaders change, so stale cache files get rebuilt
+constexpr int ENVIRONMENT_CACHE_VERSION = 3;
+
+const std::filesystem::path BRDF_LUT_CACHE_PATH = "cache/brdf_lut.ktx2";
+
+// Per frame budget of an import's GL stage
+constexpr size_t IMPORT_UPLOAD_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+// Radiance of the flat grey sky used until the first environment is ready
+const glm::vec3 FALLBACK_AMBIENT(0.03f);
+
+EnvironmentRenderPass::EnvironmentRenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext), importStage(ImportStage::IDLE), decoded(), importStep(0),
+	equirectangularMap(0), environmentMap(0), importedMap(0), quad(RenderableModel::constructUnitQuad())
+{
+	equirectangularShader.addShader(GL_COMPUTE_SHADER, "shaders/environment_pass/equirectangular_to_cubemap.comp.glsl");
+
+	brdfShader.addShader(GL_VERTEX_SHADER, "shaders/hdr_pass/hdr_pass.vert.glsl");
+	brdfShader.addShader(GL_FRAGMENT_SHADER, "shaders/environment_pass/brdf_lut.frag.glsl");
+
+	glGenFramebuffers(1, &framebuffer);
+
+	// Doesn't depend on the environment, only needs building once
+	buildBRDFLUT();
+}
+
+EnvironmentRenderPass::~EnvironmentRenderPass()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+
+	glDeleteTextures(1, &equirectangularMap);
+	glDeleteTextures(1, &environmentMap);
+	glDeleteTextures(1, &importedMap);
+
+	// Writes already started are waited on as cacheWrites is destroyed, readbacks still on the GPU are dropped
+	for (auto& [path, download] : cacheDownloads) releaseDownloadTexture(download);
+}
+
+void EnvironmentRenderPass::frame()
+{
+	PROFILE_SCOPE("EnvironmentRenderPass::frame");
+
+	updateCacheWrites();
+
+	switch (importStage)
+	{
+	case ImportStage::IDLE:
+		break;
+
+	case ImportStage::DECODING:
+		if (decodeResult.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			decoded = decodeResult.get();
+			beginGLStage();
+		}
+		break;
+
+	case ImportStage::UPLOADING:
+		uploadRows();
+		break;
+
+	case ImportStage::CONVERTING:
+		convertToCubemap();
+		break;
+
+	case ImportStage::PREFILTERING:
+		prefilterMips();
+		break;
+	}
+}
+
+void EnvironmentRenderPass::refresh()
+{
+}
+
+bool EnvironmentRenderPass::loadEnvironment(const std::string& path)
+{
+	if (!std::filesystem::exists(path))
+	{
+		spdlog::error("Failed to load environment map: {}", path);
+		return false;
+	}
+
+	// Only the latest request matters, it's picked up once the current import finishes
+	if (importStage != ImportStage::IDLE)
+	{
+		queuedPath = path;
+		return true;
+	}
+
+	startImport(path);
+	return true;
+}
+
+void EnvironmentRenderPass::startImport(const std::string& path)
+{
+	// Something to light the scene with in the meantime
+	if (!hasEnvironment())
+	{
+		createFallbackEnvironment();
+	}
+
+	decodeResult = std::async(std::launch::async, &EnvironmentRenderPass::decodeEnvironment, path);
+	importStage = ImportStage::DECODING;
+}
+
+EnvironmentRenderPass::DecodedEnvironment EnvironmentRenderPass::decodeEnvironment(const std::string& path)
+{
+	DecodedEnvironment result = { };
+	result.path = path;
+
+	// Next to the source, keyed by its contents and everything that affects the filtering
+	result.cacheKey = std::format("{:016x}:{}:{}:{}:{}", hashFile(path), ENVIRONMENT_CACHE_VERSION,
+		ENVIRONMENT_MAP_DIMENSIONS, PREFILTERED_MAP_DIMENSIONS, PREFILTERED_MAP_MIPS);
+
+	std::optional<KTXImage> cached = readKTX2(getCachePath(path), GL_TEXTURE_CUBE_MAP, GL_RGBA16F);
+	if (cached)
+	{
+		const std::string& cachedSH = cached->metadata["irradianceSH"];
+		const std::string& cachedSun = cached->metadata["sun"];
+
+		if (cached->metadata["cacheKey"] == result.cacheKey && cachedSH.size() == sizeof(result.irradianceSH.coefficients) &&
+			cachedSun.size() == sizeof(SunEstimate))
+		{
+			std::memcpy(result.irradianceSH.coefficients.data(), cachedSH.data(), cachedSH.size());
+			std::memcpy(&result.sun, cachedSun.data(), cachedSun.size());
+
+			result.cached = std::move(cached);
+			result.valid = true;
+			return result;
+		}
+
+		spdlog::info("Environment cache out of date: {}", getCachePath(path).string());
+	}
+
+	int width, height, channels;
+	float* data = stbi_loadf(path.c_str(), &width, &height, &channels, 3);
+	if (!data || width + height < 2)
+	{
+		spdlog::error("Failed to load environment map: {}", path);
+
+		stbi_image_free(data);
+		return result;
+	}
+
+	result.dimensions = glm::ivec2(width, height);
+	result.pixels.assign(data, data + static_cast<size_t>(width) * height * 3);
+
+	stbi_image_free(data);
+
+	// Bottom row first for GL. Flipped here rather than with stbi_set_flip_vertically_on_load, that's global state
+	const size_t rowLength = static_cast<size_t>(width) * 3;
+	for (int y = 0; y < height / 2; y++)
+	{
+		std::swap_ranges(result.pixels.begin() + y * rowLength, result.pixels.begin() + (y + 1) * rowLength,
+			result.pixels.begin() + (height - 1 - y) * rowLength);
+	}
+
+	// Diffuse straight from the source pixels, no irradiance cubemap to render or sample
+	result.irradianceSH = convolveIrradiance(projectEquirectangular(result.pixels.data(), width, height, 3));
+	result.sun = estimateSun(result.pixels.data(), width, height, 3);
+
+	result.valid = true;
+	return result;
+}
+
+void EnvironmentRenderPass::beginGLStage()
+{
+	if (!decoded.valid)
+	{
+		finishImport();
+		return;
+	}
+
+	// A few MB of already filtered data, not worth spreading out
+	if (decoded.cached)
+	{
+		importedMap = uploadTexture(*decoded.cached);
+
+		setCubemapParameters(importedMap);
+		glTextureParameteri(importedMap, GL_TEXTURE_MAX_LEVEL, PREFILTERED_MAP_MIPS - 1);
+
+		finishImport();
+		return;
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &equirectangularMap);
+	glTextureStorage2D(equirectangularMap, 1, GL_RGB32F, decoded.dimensions.x, decoded.dimensions.y);
+
+	glTextureParameteri(equirectangularMap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(equirectangularMap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(equirectangularMap, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(equirectangularMap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	importStep = 0;
+	importStage = ImportStage::UPLOADING;
+}
+
+void EnvironmentRenderPass::uploadRows()
+{
+	const size_t rowBytes = static_cast<size_t>(decoded.dimensions.x) * 3 * sizeof(float);
+	const int rows = std::min(std::max(static_cast<int>(IMPORT_UPLOAD_BYTES_PER_FRAME / rowBytes), 1), decoded.dimensions.y - importStep);
+
+	glTextureSubImage2D(equirectangularMap, 0, 0, importStep, decoded.dimensions.x, rows, GL_RGB, GL_FLOAT,
+		decoded.pixels.data() + static_cast<size_t>(importStep) * decoded.dimensions.x * 3);
+
+	importStep += rows;
+	if (importStep < decoded.dimensions.y) return;
+
+	decoded.pixels = { };
+
+	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &environmentMap);
+
+	const int mips = static_cast<int>(std::log2(ENVIRONMENT_MAP_DIMENSIONS)) + 1;
+	glTextureStorage2D(environmentMap, mips, GL_RGBA16F, ENVIRONMENT_MAP_DIMENSIONS, ENVIRONMENT_MAP_DIMENSIONS);
+
+	setCubemapParameters(environmentMap);
+
+	importStage = ImportStage::CONVERTING;
+}
+
+void EnvironmentRenderPass::convertToCubemap()
+{
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, equirectangularMap);
+
+	equirectangularShader.use();
+	equirectangularShader.setInt("uEquirectangularMap", 0);
+
+	glBindImageTexture(0, environmentMap, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	dispatchCubemap(ENVIRONMENT_MAP_DIMENSIONS);
+
+	glDeleteTextures(1, &equirectangularMap);
+	equirectangularMap = 0;
+
+	// Mipped for the prefilter's sampling
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+	glGenerateTextureMipmap(environmentMap);
+
+	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &importedMap);
+	glTextureStorage2D(importedMap, PREFILTERED_MAP_MIPS, GL_RGBA16F, PREFILTERED_MAP_DIMENSIONS, PREFILTERED_MAP_DIMENSIONS);
+
+	setCubemapParameters(importedMap);
+	glTextureParameteri(importedMap, GL_TEXTURE_MAX_LEVEL, PREFILTERED_MAP_MIPS - 1);
+
+	importStage = ImportStage::PREFILTERING;
+}
+
+void EnvironmentRenderPass::prefilterMips()
+{
+	prefilter.prefilter(environmentMap, importedMap, PREFILTERED_MAP_DIMENSIONS, PREFILTERED_MAP_MIPS);
+
+	glDeleteTextures(1, &environmentMap);
+	environmentMap = 0;
+
+	// Read back once the GPU gets to it, a later frame passes it on to be written
+	PendingDownload download = beginDownloadTexture(importedMap, GL_TEXTURE_CUBE_MAP, GL_RGBA16F);
+
+	KTXMetadata& metadata = download.image.metadata;
+	metadata["cacheKey"] = decoded.cacheKey;
+	metadata["irradianceSH"] = std::string(reinterpret_cast<const char*>(decoded.irradianceSH.coefficients.data()),
+		sizeof(decoded.irradianceSH.coefficients));
+	metadata["sun"] = std::string(reinterpret_cast<const char*>(&decoded.sun), sizeof(SunEstimate));
+
+	cacheDownloads.emplace_back(getCachePath(decoded.path), std::move(download));
+
+	finishImport();
+}
+
+void EnvironmentRenderPass::dispatchCubemap(int faceDimensions)
+{
+	glDispatchCompute((faceDimensions + 7) / 8, (faceDimensions + 7) / 8, 6);
+}
+
+void EnvironmentRenderPass::finishImport()
+{
+	if (decoded.valid)
+	{
+		replaceTexture("prefilteredMap", importedMap);
+		renderContext.irradianceSH = decoded.irradianceSH;
+		renderContext.environmentSun = decoded.sun;
+	}
+
+	importedMap = 0;
+	decoded = { };
+	importStage = ImportStage::IDLE;
+
+	if (!queuedPath.empty())
+	{
+		startImport(std::exchange(queuedPath, { }));
+	}
+}
+
+void EnvironmentRenderPass::updateCacheWrites()
+{
+	std::erase_if(cacheDownloads, [this](auto& pending)
+		{
+			auto& [path, download] = pending;
+			if (!finishDownloadTexture(download)) return false;
+
+			cacheWrites.push_back(std::async(std::launch::async, [path = path, image = std::move(download.image)]() {
+				return writeKTX2(path, image);
+			}));
+
+			return true;
+		});
+
+	std::erase_if(cacheWrites, [](const std::future<bool>& write)
+		{
+			return write.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		});
+}
+
+void EnvironmentRenderPass::createFallbackEnvironment()
+{
+	std::array<uint16_t, 6 * 4> texels;
+	for (size_t i = 0; i < texels.size(); i++)
+	{
+		texels[i] = glm::packHalf1x16(i % 4 == 3 ? 1.0f : FALLBACK_AMBIENT[i % 4]);
+	}
+
+	GLuint fallbackMap;
+	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &fallbackMap);
+	glTextureStorage2D(fallbackMap, 1, GL_RGBA16F, 1, 1);
+	glTextureSubImage3D(fallbackMap, 0, 0, 0, 0, 1, 1, 6, GL_RGBA, GL_HALF_FLOAT, texels.data());
+
+	setCubemapParameters(fallbackMap);
+
+	replaceTexture("prefilteredMap", fallbackMap);
+
+	// Constant band only, irradiance / pi of a uniform sky is just its radiance
+	renderContext.irradianceSH = { };
+	renderContext.irradianceSH.coefficients[0] = FALLBACK_AMBIENT / 0.282095f;
+	renderContext.environmentSun = { };
+}
+
+std::filesystem::path EnvironmentRenderPass::getCachePath(const std::string& path)
+{
+	return path + ".prefiltered.ktx2";
+}
+
+void EnvironmentRenderPass::buildBRDFLUT()
+{
+	const std::string cacheKey = std::format("{}:{}", ENVIRONMENT_CACHE_VERSION, BRDF_LUT_DIMENSIONS);
+
+	KTXMetadata metadata;
+	GLuint brdfLUT = loadTextureKTX2(BRDF_LUT_CACHE_PATH, GL_TEXTURE_2D, GL_RG16F, metadata);
+
+	if (brdfLUT && metadata["cacheKey"] == cacheKey)
+	{
+		glTextureParameteri(brdfLUT, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(brdfLUT, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(brdfLUT, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(brdfLUT, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		replaceTexture("brdf", brdfLUT);
+		return;
+	}
+
+	glDeleteTextures(1, &brdfLUT);
+
+	glGenTextures(1, &brdfLUT);
+	glBindTexture(GL_TEXTURE_2D, brdfLUT);
+
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, BRDF_LUT_DIMENSIONS, BRDF_LUT_DIMENSIONS);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, brdfLUT, 0);
+
+	{
+		ScopedFramebufferBind framebufferBind(renderContext.framebufferStack, framebuffer);
+
+		glViewport(0, 0, BRDF_LUT_DIMENSIONS, BRDF_LUT_DIMENSIONS);
+
+		brdfShader.use();
+		brdfShader.setFloat("uDimensions", static_cast<float>(BRDF_LUT_DIMENSIONS));
+
+		renderPrimitive(quad->getPrimitives()[0]);
+	}
+
+	replaceTexture("brdf", brdfLUT);
+
+	std::error_code error;
+	std::filesystem::create_directories(BRDF_LUT_CACHE_PATH.parent_path(), error);
+
+	saveTextureKTX2(BRDF_LUT_CACHE_PATH, brdfLUT, GL_TEXTURE_2D, GL_RG16F, { { "cacheKey", cacheKey } });
+}
+
+void EnvironmentRenderPass::setCubemapParameters(GLuint cubemap)
+{
+	glTextureParameteri(cubemap, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(cubemap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(cubemap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(cubemap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(cubemap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
+
+void EnvironmentRenderPass::replaceTexture(const std::string& name, GLuint texture)
+{
+	if (renderContext.textures.contains(name))
+	{
+		glDeleteTextures(1, &renderContext.textures.at(name));
+	}
+
+	renderContext.textures[name] = texture;
+}
\ No newline at end of file
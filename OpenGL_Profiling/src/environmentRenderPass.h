@@ -0,0 +1,118 @@
+#pragma once
+
+#include "renderPass.h"
+#include "cubemapPrefilter.h"
+#include "textureCache.h"
+
+#include <future>
+
+// Image based lighting from an equirectangular HDR: L2 SH irradiance for diffuse (into the frame uniforms),
+// a GGX prefiltered cubemap and BRDF LUT for the split sum specular. Both are cached on disk as half float KTX2.
+// Imports decode on a worker thread, upload over a few frames, then convert and prefilter with a compute dispatch
+// per mip that writes all six faces at once
+class EnvironmentRenderPass : public RenderPass
+{
+public:
+	EnvironmentRenderPass(RenderContext& renderContext);
+	~EnvironmentRenderPass();
+
+	EnvironmentRenderPass(const EnvironmentRenderPass&) = delete;
+	EnvironmentRenderPass& operator=(const EnvironmentRenderPass&) = delete;
+
+public:
+	// Advances any import in progress
+	void frame() override;
+	void refresh() override;
+
+	// Starts importing in the background, the current environment (or a flat ambient if there isn't one yet)
+	// is used until it's ready. False if the file doesn't exist
+	bool loadEnvironment(const std::string& path);
+
+	bool hasEnvironment() const { return renderContext.textures.contains("prefilteredMap"); }
+	bool isImporting() const { return importStage != ImportStage::IDLE; }
+
+private:
+	// Everything the worker thread produces, no GL
+	struct DecodedEnvironment
+	{
+		std::string path;
+		std::string cacheKey;
+
+		std::optional<KTXImage> cached; // Prefiltered map from a previous run, nothing else is filled in then
+
+		std::vector<float> pixels; // RGB, bottom row first
+		glm::ivec2 dimensions;
+
+		SphericalHarmonics irradianceSH;
+		SunEstimate sun;
+
+		bool valid;
+	};
+
+	enum class ImportStage
+	{
+		IDLE,
+		DECODING,		// Worker thread
+		UPLOADING,		// Equirectangular rows into equirectangularMap
+		CONVERTING,		// Equirectangular -> environmentMap, one frame
+		PREFILTERING	// environmentMap -> every mip of importedMap, one frame
+	};
+
+	void startImport(const std::string& path);
+
+	// Hash, cache lookup, and if that misses: decode, SH and sun
+	static DecodedEnvironment decodeEnvironment(const std::string& path);
+
+	// One per stage, each only does a frame's worth of work
+	void beginGLStage();
+	void uploadRows();
+	void convertToCubemap();
+	void prefilterMips();
+
+	// Swaps the result in, and moves on to any queued import
+	void finishImport();
+
+	// Hands finished readbacks to a worker to write out, and forgets finished writes
+	void updateCacheWrites();
+
+	void createFallbackEnvironment();
+
+	static std::filesystem::path getCachePath(const std::string& path);
+
+	// Loaded from the disk cache when it can be
+	void buildBRDFLUT();
+
+	// All six faces of a cube image bound at unit 0, for the 8x8 environment compute shaders
+	void dispatchCubemap(int faceDimensions);
+
+	void setCubemapParameters(GLuint cubemap);
+
+	// Deletes whatever was registered under the name before
+	void replaceTexture(const std::string& name, GLuint texture);
+
+private:
+	ShaderProgram equirectangularShader;
+	ShaderProgram brdfShader;
+
+	CubemapPrefilter prefilter;
+
+	GLuint framebuffer;
+
+	ImportStage importStage;
+	std::future<DecodedEnvironment> decodeResult;
+	DecodedEnvironment decoded;
+	std::string queuedPath; // Latest load requested while another import was running
+
+	int importStep; // Rows uploaded so far
+
+	// In progress, only swapped into the render context once complete
+	GLuint equirectangularMap;
+	GLuint environmentMap; // 1024, mipped, the prefilter's source
+	GLuint importedMap;
+
+	// Prefiltered maps on their way back from the GPU, then onto disk
+	std::vector<std::pair<std::filesystem::path, PendingDownload>> cacheDownloads;
+	std::vector<std::future<bool>> cacheWrites;
+
+	const std::shared_ptr<RenderableModel> quad;
+};
\ No newline at end of file
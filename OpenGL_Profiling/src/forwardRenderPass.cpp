@@ -1,84 +1,123 @@
 #include "forwardRenderPass.h"
 
 ForwardRenderPass::ForwardRenderPass(RenderContext& frameDesc)
-	: RenderPass(frameDesc)
+	: RenderPass(frameDesc),
+	permutations({
+		{ GL_VERTEX_SHADER, "shaders/forward_pass/forward_pass.vert.glsl" },
+		{ GL_FRAGMENT_SHADER, "shaders/forward_pass/forward_pass.frag.glsl" }
+	}, FORWARD_FEATURE_NAMES)
 {
-	forwardPassShader.addShader(GL_VERTEX_SHADER, "shaders/forward_pass/forward_pass.vert.glsl");
-	forwardPassShader.addShader(GL_FRAGMENT_SHADER, "shaders/forward_pass/forward_pass.frag.glsl");
+	// The plainest permutation, what everything falls back to while its own compiles
+	permutations.prepare(0);
 }
 
 void ForwardRenderPass::frame()
 {
-	forwardPassShader.use();
-	renderContext.buffers.bindBuffers(forwardPassShader);
+	PROFILE_SCOPE("ForwardRenderPass::frame");
 
 	if (renderContext.flags[SHADOWS_ENABLED])
 	{
 		glActiveTexture(GL_TEXTURE5);
-		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, renderContext.textures.at("pointShadowMaps"));
-
-		forwardPassShader.setInt("uPointShadowMaps", 5);
-
-		glActiveTexture(GL_TEXTURE6);
-		glBindTexture(GL_TEXTURE_2D_ARRAY, renderContext.textures.at("directionalShadowMaps"));
-
-		forwardPassShader.setInt("uDirectionalShadowMaps", 6);
+		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("shadowAtlas"));
 	}
 
 	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED])
 	{
-		glActiveTexture(GL_TEXTURE7);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, renderContext.textures.at("irradianceMap"));
-
-		forwardPassShader.setInt("uIrradianceMap", 7);
-
+		// Diffuse comes from the SH in the frame uniforms
 		glActiveTexture(GL_TEXTURE8);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, renderContext.textures.at("prefilteredMap"));
 
-		forwardPassShader.setInt("uPrefilteredMap", 8);
-
 		glActiveTexture(GL_TEXTURE9);
 		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("brdf"));
+	}
 
-		forwardPassShader.setInt("uBRDF", 9);
+	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED] && renderContext.flags[REFLECTION_PROBES_ENABLED])
+	{
+		glActiveTexture(GL_TEXTURE10);
+		glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, renderContext.textures.at("reflectionProbes"));
 	}
 
 	// Render opaque primitives - only if there is no deferred pass running
 	if (!renderContext.flags[DEFERRED_PASS_ENABLED])
 	{
-		for (size_t i = 0; i < renderContext.scene->sceneModels.size(); i++)
-		{
-			loadJoints(renderContext.scene->sceneModels[i]);
-
-			for (const auto& prim : renderContext.scene->sceneModels[i]->getOpaquePrimitives())
-			{
-				parseMaterialProperties(renderContext.scene->sceneModels[i]->getTextures(), prim->materialDesc);
-
-				renderPrimitive(prim);
-			}
-		}
+		ScopedGPUProfile scope(renderContext.gpuProfiler, "Opaque");
+		renderBuckets(bucketDraws(false));
 	}
 
 	// Enable blending and render the translucent primitives
 
+	ScopedGPUProfile scope(renderContext.gpuProfiler, "Translucent");
+
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	for (size_t i = 0; i < renderContext.scene->sceneModels.size(); i++)
+	// Velocity is overwritten, blending it by the colour's alpha makes no sense
+	glDisablei(GL_BLEND, 1);
+
+	// Bucketing reorders them, fine while nothing sorts translucent draws by depth anyway
+	renderBuckets(bucketDraws(true));
+
+	glDisable(GL_BLEND);
+}
+
+void ForwardRenderPass::refresh()
+{
+}
+
+ForwardRenderPass::DrawBuckets ForwardRenderPass::bucketDraws(bool translucent) const
+{
+	DrawBuckets buckets;
+
+	for (const auto& model : renderContext.scene->sceneModels)
 	{
-		loadJoints(renderContext.scene->sceneModels[i]);
+		const auto& prims = translucent ? model->getTranslucentPrimitives() : model->getOpaquePrimitives();
 
-		for (const auto& prim : renderContext.scene->sceneModels[i]->getTranslucentPrimitives())
+		for (const auto& prim : prims)
 		{
-			parseMaterialProperties(renderContext.scene->sceneModels[i]->getTextures(), prim->materialDesc);
-
-			renderPrimitive(prim);
+			buckets[getMaterialFeatures(prim->materialDesc)].push_back({ model, prim });
 		}
 	}
 
-	glDisable(GL_BLEND);
+	return buckets;
 }
 
-void ForwardRenderPass::refresh()
+void ForwardRenderPass::renderBuckets(const DrawBuckets& buckets)
+{
+	const ShaderFeatures frameFeatures = getFrameFeatures();
+
+	for (const auto& [materialFeatures, draws] : buckets)
+	{
+		ShaderProgram& program = permutations.getReadyOrFallback(frameFeatures | materialFeatures);
+
+		program.use();
+		renderContext.buffers.bindBuffers(program);
+
+		setupProgram(program);
+
+		const RenderableModel* jointsLoaded = nullptr;
+
+		for (const auto& draw : draws)
+		{
+			// Draws stay in model order inside a bucket, so joints only change between models
+			if (draw.model.get() != jointsLoaded)
+			{
+				loadJoints(draw.model);
+				jointsLoaded = draw.model.get();
+			}
+
+			parseMaterialProperties(program, draw.model->getTextures(), draw.prim->materialDesc);
+
+			renderPrimitive(draw.prim);
+		}
+	}
+}
+
+void ForwardRenderPass::setupProgram(ShaderProgram& program)
 {
+	// Each sampler type needs a unit of its own, left on unit 0 they'd clash with the material textures.
+	// Samplers a permutation compiled out just have no location
+	program.setInt("uShadowAtlas", 5);
+	program.setInt("uPrefilteredMap", 8);
+	program.setInt("uBRDF", 9);
+	program.setInt("uReflectionProbes", 10);
 }
@@ -11,6 +11,24 @@ public:
 	void frame() override;
 	void refresh() override;
 
+	size_t getNumPermutations() const { return permutations.getNumPermutations(); }
+
+private:
+	struct Draw
+	{
+		std::shared_ptr<RenderableModel> model;
+		std::shared_ptr<MeshPrimitive> prim;
+	};
+
+	using DrawBuckets = std::map<ShaderFeatures, std::vector<Draw>>;
+
+	// By material features, then each bucket is drawn with its own permutation so programs are bound once
+	DrawBuckets bucketDraws(bool translucent) const;
+	void renderBuckets(const DrawBuckets& buckets);
+
+	// Sampler units and the frame's textures, once per program
+	void setupProgram(ShaderProgram& program);
+
 private:
-	ShaderProgram forwardPassShader;
+	ShaderPermutationCache permutations;
 };
\ No newline at end of file
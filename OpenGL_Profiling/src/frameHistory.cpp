@@ -0,0 +1,70 @@
+#include "frameHistory.h"
+
+#include <algorithm>
+
+FrameHistory::FrameHistory()
+	: frames(), firstFrame(0), paused(false), selectedFrame(0)
+{ }
+
+void FrameHistory::record(float milliseconds, const std::vector<CPUProfiler::Zone>& cpuZones, const std::vector<GPUProfiler::Scope>& gpuScopes)
+{
+	if (paused) return;
+
+	if (frames.size() < WINDOW_SIZE)
+	{
+		frames.push_back({ milliseconds, cpuZones, gpuScopes });
+		return;
+	}
+
+	// Reuses the oldest frame's storage
+	Frame& frame = frames[firstFrame];
+	frame.milliseconds = milliseconds;
+	frame.cpuZones.assign(cpuZones.begin(), cpuZones.end());
+	frame.gpuScopes.assign(gpuScopes.begin(), gpuScopes.end());
+
+	firstFrame = (firstFrame + 1) % WINDOW_SIZE;
+}
+
+float FrameHistory::getPercentile(float p) const
+{
+	if (frames.empty()) return 0.0f;
+
+	std::vector<float> sorted;
+	sorted.reserve(frames.size());
+	for (const Frame& frame : frames) sorted.push_back(frame.milliseconds);
+
+	const size_t rank = std::min(static_cast<size_t>(p * static_cast<float>(sorted.size())), sorted.size() - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+	return sorted[rank];
+}
+
+float FrameHistory::getMax() const
+{
+	float max = 0.0f;
+	for (const Frame& frame : frames) max = std::max(max, frame.milliseconds);
+
+	return max;
+}
+
+void FrameHistory::setPaused(bool paused)
+{
+	this->paused = paused;
+
+	if (paused && !frames.empty()) selectedFrame = frames.size() - 1;
+}
+
+std::optional<size_t> FrameHistory::getInspectedFrame() const
+{
+	if (frames.empty()) return std::nullopt;
+
+	return paused ? selectedFrame : frames.size() - 1;
+}
+
+void FrameHistory::select(size_t index)
+{
+	if (index >= frames.size()) return;
+
+	paused = true;
+	selectedFrame = index;
+}
\ No newline at end of file
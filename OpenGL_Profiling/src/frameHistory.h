@@ -0,0 +1,53 @@
+#pragma once
+
+#include "cpuProfiler.h"
+#include "gpuProfiler.h"
+
+#include <optional>
+#include <vector>
+
+// The last WINDOW_SIZE frames: their times, CPU zones and GPU scopes, for the metrics window to graph.
+// Pausing stops recording so a frame picked off the graph can be inspected without it scrolling away
+class FrameHistory
+{
+public:
+	static constexpr size_t WINDOW_SIZE = 240;
+
+	struct Frame
+	{
+		float milliseconds;
+
+		std::vector<CPUProfiler::Zone> cpuZones;
+
+		// The GPU profiler's latest resolved frame when this one was recorded, a few frames older
+		std::vector<GPUProfiler::Scope> gpuScopes;
+	};
+
+public:
+	FrameHistory();
+
+	// Once a frame, after CPUProfiler::endFrame. Ignored while paused
+	void record(float milliseconds, const std::vector<CPUProfiler::Zone>& cpuZones, const std::vector<GPUProfiler::Scope>& gpuScopes);
+
+	// Oldest first
+	size_t getNumFrames() const { return frames.size(); }
+	const Frame& getFrame(size_t index) const { return frames[(firstFrame + index) % frames.size()]; }
+
+	// p in [0, 1], over the window
+	float getPercentile(float p) const;
+	float getMax() const;
+
+	bool isPaused() const { return paused; }
+	void setPaused(bool paused);
+
+	// The selected frame while paused, the newest otherwise
+	std::optional<size_t> getInspectedFrame() const;
+	void select(size_t index);
+
+private:
+	std::vector<Frame> frames;
+	size_t firstFrame;
+
+	bool paused;
+	size_t selectedFrame;
+};
\ No newline at end of file
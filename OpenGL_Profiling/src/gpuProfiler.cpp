@@ -0,0 +1,277 @@
+#include "gpuProfiler.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Vertex shader invocations, clipping input and output primitives, fragment shader invocations.
+	// ARB_pipeline_statistics_query's tokens, which not every GLAD build declares
+	constexpr std::array<GLenum, 4> PIPELINE_STATISTICS_TARGETS = { 0x82F0, 0x82F6, 0x82F7, 0x82F4 };
+
+	bool hasPipelineStatistics()
+	{
+		if (GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 6)) return true;
+
+		GLint numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+
+		for (GLint i = 0; i < numExtensions; i++)
+		{
+			const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (extension && std::strcmp(extension, "GL_ARB_pipeline_statistics_query") == 0) return true;
+		}
+
+		return false;
+	}
+}
+
+ProfileStats::ProfileStats()
+	: samples(), nextSample(0)
+{ }
+
+void ProfileStats::addSample(float milliseconds)
+{
+	if (samples.size() < WINDOW_SIZE)
+	{
+		samples.push_back(milliseconds);
+	}
+	else
+	{
+		samples[nextSample] = milliseconds;
+	}
+
+	nextSample = (nextSample + 1) % WINDOW_SIZE;
+}
+
+float ProfileStats::getAverage() const
+{
+	if (samples.empty()) return 0.0f;
+
+	float total = 0.0f;
+	for (const float sample : samples) total += sample;
+
+	return total / static_cast<float>(samples.size());
+}
+
+float ProfileStats::getPercentile(float p) const
+{
+	if (samples.empty()) return 0.0f;
+
+	std::vector<float> sorted = samples;
+
+	const size_t rank = std::min(static_cast<size_t>(p * static_cast<float>(sorted.size())), sorted.size() - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+	return sorted[rank];
+}
+
+GPUProfiler::GPUProfiler()
+	: frames(), currentFrame(0), inFrame(false), openScopes(), latestFrame(), stats(),
+	pipelineStatisticsSupported(hasPipelineStatistics()), pipelineStatistics(false)
+{ }
+
+GPUProfiler::~GPUProfiler()
+{
+	for (auto& frame : frames)
+	{
+		if (!frame.queries.empty()) glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+
+		if (!frame.statisticsQueries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(frame.statisticsQueries.size()), frame.statisticsQueries.data());
+		}
+	}
+}
+
+void GPUProfiler::beginFrame()
+{
+	currentFrame = (currentFrame + 1) % NUM_FRAMES;
+
+	// Oldest first, so the latest results really are the latest. That's the slot about to be reused,
+	// NUM_FRAMES ago, then each newer one until a frame isn't done yet
+	for (size_t i = 0; i < NUM_FRAMES; i++)
+	{
+		FrameQueries& frame = frames[(currentFrame + i) % NUM_FRAMES];
+		if (!frame.pending) continue;
+
+		// The reused slot has to be read now, however long that takes
+		const bool reusing = i == 0;
+		if (!resolveFrame(frame, reusing)) break;
+	}
+
+	FrameQueries& frame = frames[currentFrame];
+	frame.numUsed = 0;
+	frame.numStatisticsUsed = 0;
+	frame.scopes.clear();
+
+	inFrame = true;
+	openScopes.clear();
+
+	beginScope("Frame");
+}
+
+void GPUProfiler::endFrame()
+{
+	if (!inFrame) return;
+
+	// Any scope left open ends with the frame
+	while (!openScopes.empty()) endScope();
+
+	frames[currentFrame].pending = true;
+	inFrame = false;
+}
+
+std::string GPUProfiler::beginScope(const std::string& name)
+{
+	if (!inFrame) return {};
+
+	FrameQueries& frame = frames[currentFrame];
+
+	const int depth = static_cast<int>(openScopes.size());
+	const std::string path = openScopes.empty() ? name : frame.scopes[openScopes.back()].path + "/" + name;
+
+	const size_t beginQuery = frame.numUsed;
+	glQueryCounter(nextQuery(), GL_TIMESTAMP);
+
+	std::optional<size_t> statisticsQuery;
+
+	// Inside the timestamps, so the pass's time doesn't include the queries starting
+	if (pipelineStatistics && depth == 1)
+	{
+		statisticsQuery = nextStatisticsQueries();
+
+		for (size_t i = 0; i < NUM_PIPELINE_STATISTICS; i++)
+		{
+			glBeginQuery(PIPELINE_STATISTICS_TARGETS[i], frame.statisticsQueries[*statisticsQuery + i]);
+		}
+	}
+
+	openScopes.push_back(frame.scopes.size());
+	frame.scopes.push_back({ name, path, depth, beginQuery, beginQuery, statisticsQuery });
+
+	return path;
+}
+
+void GPUProfiler::endScope()
+{
+	if (!inFrame || openScopes.empty()) return;
+
+	FrameQueries& frame = frames[currentFrame];
+
+	PendingScope& scope = frame.scopes[openScopes.back()];
+
+	if (scope.statisticsQuery)
+	{
+		for (const GLenum target : PIPELINE_STATISTICS_TARGETS) glEndQuery(target);
+	}
+
+	scope.endQuery = frame.numUsed;
+	glQueryCounter(nextQuery(), GL_TIMESTAMP);
+
+	openScopes.pop_back();
+}
+
+const ProfileStats* GPUProfiler::getStats(const std::string& path) const
+{
+	const auto found = stats.find(path);
+
+	return found == stats.end() ? nullptr : &found->second;
+}
+
+float GPUProfiler::getLatestMilliseconds(const std::string& path) const
+{
+	const auto found = std::find_if(latestFrame.begin(), latestFrame.end(), [&](const Scope& scope) { return scope.path == path; });
+
+	return found == latestFrame.end() ? 0.0f : found->getMilliseconds();
+}
+
+GLuint GPUProfiler::nextQuery()
+{
+	FrameQueries& frame = frames[currentFrame];
+
+	if (frame.numUsed == frame.queries.size())
+	{
+		GLuint query;
+		glGenQueries(1, &query);
+		frame.queries.push_back(query);
+	}
+
+	return frame.queries[frame.numUsed++];
+}
+
+size_t GPUProfiler::nextStatisticsQueries()
+{
+	FrameQueries& frame = frames[currentFrame];
+
+	if (frame.numStatisticsUsed == frame.statisticsQueries.size())
+	{
+		frame.statisticsQueries.resize(frame.statisticsQueries.size() + NUM_PIPELINE_STATISTICS);
+		glGenQueries(static_cast<GLsizei>(NUM_PIPELINE_STATISTICS), frame.statisticsQueries.data() + frame.numStatisticsUsed);
+	}
+
+	const size_t first = frame.numStatisticsUsed;
+	frame.numStatisticsUsed += NUM_PIPELINE_STATISTICS;
+
+	return first;
+}
+
+bool GPUProfiler::resolveFrame(FrameQueries& frame, bool wait)
+{
+	// The last timestamp written, once it's there they all are
+	if (!wait)
+	{
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(frame.queries[frame.numUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+		if (!available) return false;
+	}
+
+	std::vector<GLuint64> timestamps(frame.numUsed);
+	for (size_t i = 0; i < frame.numUsed; i++)
+	{
+		glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+	}
+
+	const GLuint64 frameStart = timestamps[frame.scopes.front().beginQuery];
+
+	latestFrame.clear();
+	for (const auto& scope : frame.scopes)
+	{
+		const float start = static_cast<float>(timestamps[scope.beginQuery] - frameStart) / 1000000.0f;
+		const float end = static_cast<float>(timestamps[scope.endQuery] - frameStart) / 1000000.0f;
+
+		std::optional<PipelineStatistics> statistics;
+
+		// Ended before the frame's last timestamp, they're done (or very nearly) by now
+		if (scope.statisticsQuery)
+		{
+			std::array<GLuint64, NUM_PIPELINE_STATISTICS> counters = {};
+			for (size_t i = 0; i < NUM_PIPELINE_STATISTICS; i++)
+			{
+				glGetQueryObjectui64v(frame.statisticsQueries[*scope.statisticsQuery + i], GL_QUERY_RESULT, &counters[i]);
+			}
+
+			statistics = PipelineStatistics{ counters[0], counters[1], counters[2], counters[3] };
+		}
+
+		latestFrame.push_back({ scope.name, scope.path, scope.depth, start, end, statistics });
+
+		stats[scope.path].addSample(end - start);
+	}
+
+	frame.pending = false;
+
+	return true;
+}
+
+ScopedGPUProfile::ScopedGPUProfile(GPUProfiler& profiler, const std::string& name)
+	: profiler(profiler), path(profiler.beginScope(name))
+{ }
+
+ScopedGPUProfile::~ScopedGPUProfile()
+{
+	profiler.endScope();
+}
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Rolling window of one scope's timings
+class ProfileStats
+{
+public:
+	ProfileStats();
+
+	void addSample(float milliseconds);
+
+	float getAverage() const;
+
+	// p in [0, 1], over the window
+	float getPercentile(float p) const;
+
+private:
+	static constexpr size_t WINDOW_SIZE = 240;
+
+	std::vector<float> samples;
+	size_t nextSample;
+};
+
+// ARB_pipeline_statistics_query counters of one scope
+struct PipelineStatistics
+{
+	uint64_t vertexShaderInvocations = 0;
+	uint64_t clippingInputPrimitives = 0;
+	uint64_t clippingOutputPrimitives = 0; // After clipping and culling, what gets rasterized
+	uint64_t fragmentShaderInvocations = 0;
+};
+
+// GPU time of a frame, split into nested scopes: the renderer opens one around each pass's frame(),
+// passes can open their own inside. Each scope is a pair of GL_TIMESTAMP queries, frames rotate through
+// a ring NUM_FRAMES deep so a frame's results are read NUM_FRAMES - 1 frames later, without stalling
+class GPUProfiler
+{
+public:
+	// One scope of a resolved frame
+	struct Scope
+	{
+		std::string name;
+		std::string path; // Parent names and this one, "/" separated. What the stats are keyed by
+		int depth; // 0 for the frame itself
+
+		// From the start of the frame
+		float startMilliseconds;
+		float endMilliseconds;
+
+		float getMilliseconds() const { return endMilliseconds - startMilliseconds; }
+
+		// Passes (depth 1) only, while pipeline statistics are on
+		std::optional<PipelineStatistics> statistics;
+	};
+
+public:
+	GPUProfiler();
+	~GPUProfiler();
+
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+public:
+	// Collects whichever earlier frames have finished and opens the frame's root scope
+	void beginFrame();
+	void endFrame();
+
+	// Ignored outside beginFrame / endFrame. Returns the scope's path, empty when ignored
+	std::string beginScope(const std::string& name);
+	void endScope();
+
+	// Pre-order, the frame first, of the newest frame with results
+	const std::vector<Scope>& getLatestFrame() const { return latestFrame; }
+
+	// Nothing until a scope with this path has been resolved
+	const ProfileStats* getStats(const std::string& path) const;
+
+	// The scope's time in the latest frame, 0 if it didn't run
+	float getLatestMilliseconds(const std::string& path) const;
+
+	// ARB_pipeline_statistics_query, or GL 4.6
+	bool supportsPipelineStatistics() const { return pipelineStatisticsSupported; }
+
+	// Debug mode, each pass also counts its shader invocations and primitives. Only one query of each counter
+	// can run at a time, so scopes inside a pass don't get their own. Takes effect from the next frame
+	bool getPipelineStatistics() const { return pipelineStatistics; }
+	void setPipelineStatistics(bool pipelineStatistics) { this->pipelineStatistics = pipelineStatistics && pipelineStatisticsSupported; }
+
+private:
+	struct PendingScope
+	{
+		std::string name;
+		std::string path;
+		int depth;
+		size_t beginQuery;
+		size_t endQuery;
+		std::optional<size_t> statisticsQuery; // First of the scope's NUM_PIPELINE_STATISTICS
+	};
+
+	struct FrameQueries
+	{
+		std::vector<GLuint> queries; // Grown as frames need more, never shrunk
+		size_t numUsed = 0;
+
+		std::vector<GLuint> statisticsQueries; // Same, for the pipeline statistics
+		size_t numStatisticsUsed = 0;
+
+		std::vector<PendingScope> scopes;
+		bool pending = false;
+	};
+
+	GLuint nextQuery();
+	size_t nextStatisticsQueries();
+
+	// wait stalls until the GPU is done, for a frame whose queries are about to be reused
+	bool resolveFrame(FrameQueries& frame, bool wait);
+
+private:
+	static constexpr size_t NUM_FRAMES = 4;
+	static constexpr size_t NUM_PIPELINE_STATISTICS = 4;
+
+	std::array<FrameQueries, NUM_FRAMES> frames;
+	size_t currentFrame;
+	bool inFrame;
+
+	std::vector<size_t> openScopes; // Indices into the current frame's scopes
+
+	std::vector<Scope> latestFrame;
+	std::map<std::string, ProfileStats> stats;
+
+	bool pipelineStatisticsSupported;
+	bool pipelineStatistics;
+};
+
+// Times the enclosing block
+class ScopedGPUProfile
+{
+public:
+	ScopedGPUProfile(GPUProfiler& profiler, const std::string& name);
+	~ScopedGPUProfile();
+
+	ScopedGPUProfile(const ScopedGPUProfile&) = delete;
+	ScopedGPUProfile& operator=(const ScopedGPUProfile&) = delete;
+
+	// To find the scope's results later, see GPUProfiler::getLatestMilliseconds
+	const std::string& getPath() const { return path; }
+
+private:
+	GPUProfiler& profiler;
+	const std::string path;
+};
\ No newline at end of file
@@ -1,62 +1,378 @@
 #include "hdrRenderPass.h"
 
-HDRRenderPass::HDRRenderPass(RenderContext& renderContext)
-	: RenderPass(renderContext), quad(RenderableModel::constructUnitQuad())
+#include <spdlog/spdlog.h>
+
+struct HDRFormatDesc
 {
-	glGenFramebuffers(1, &framebuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);	
+	GLenum internalFormat;
+	GLenum format;
+	size_t bytesPerPixel;
+};
+
+static const std::array<HDRFormatDesc, NUM_HDR_FORMATS> hdrFormats = { {
+	{ GL_R11F_G11F_B10F, GL_RGB, 4 },
+	{ GL_RGBA16F, GL_RGBA, 8 },
+	{ GL_RGBA32F, GL_RGBA, 16 }
+} };
+
+// GL_DEPTH_COMPONENT24 is padded out to 32 bits on basically everything
+constexpr size_t DEPTH_BYTES_PER_PIXEL = 4;
+constexpr size_t LDR_BYTES_PER_PIXEL = 4;
+constexpr size_t VELOCITY_BYTES_PER_PIXEL = 4;
 
-	glGenRenderbuffers(1, &depthRenderBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, depthRenderBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT,
-		renderContext.dimensions.x, renderContext.dimensions.y);
+// Luminance range covered by the histogram, in log2 units
+constexpr float MIN_LOG_LUMINANCE = -10.0f;
+constexpr float MAX_LOG_LUMINANCE = 4.0f;
 
+constexpr size_t NUM_HISTOGRAM_BINS = 256;
+
+HDRRenderPass::HDRRenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext), format(HDR_FORMAT_RGBA16F), useCompute(false),
+	autoExposure(true), adaptationRate(1.5f), exposureTimer(),
+	bloomStrength(0.04f), upscaleFactor(1.0f), spatialUpscaler(false), sharpen(false), sharpness(0.5f),
+	velocityOutput(false), ambientOutput(false), quad(RenderableModel::constructUnitQuad())
+{
+	glGenFramebuffers(1, &framebuffer);
+	glGenTextures(1, &depthTexture);
 	glGenTextures(1, &colourTexture);
+	glGenTextures(1, &velocityTexture);
+	glGenTextures(1, &ambientTexture);
 
-	glBindTexture(GL_TEXTURE_2D, colourTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, renderContext.dimensions.x, renderContext.dimensions.y, 0, GL_RGBA, GL_FLOAT, 0);
+	// Owned by the context so the SSAO, bloom and TAA passes can find them, the renderer cleans them up
+	renderContext.textures["hdrDepth"] = depthTexture;
+	renderContext.textures["hdrColour"] = colourTexture;
+	renderContext.textures["velocity"] = velocityTexture;
+	renderContext.textures["hdrAmbient"] = ambientTexture;
 
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderBuffer);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colourTexture, 0);
+	glGenFramebuffers(1, &outputFramebuffer);
+	glGenTextures(1, &outputTexture);
 
-	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glGenTextures(1, &ldrTexture);
+	glGenTextures(1, &upscaledTexture);
 
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-	{
-		throw std::runtime_error("Incomplete HDR Framebuffer!");
-	}
+	allocateTargets();
 
 	hdrPassShader.addShader(GL_VERTEX_SHADER, "shaders/hdr_pass/hdr_pass.vert.glsl");
 	hdrPassShader.addShader(GL_FRAGMENT_SHADER, "shaders/hdr_pass/hdr_pass.frag.glsl");
+
+	hdrPassComputeShader.addShader(GL_COMPUTE_SHADER, "shaders/hdr_pass/hdr_pass.comp.glsl");
+
+	luminanceHistogramShader.addShader(GL_COMPUTE_SHADER, "shaders/hdr_pass/luminance_histogram.comp.glsl");
+	exposureAverageShader.addShader(GL_COMPUTE_SHADER, "shaders/hdr_pass/exposure_average.comp.glsl");
+
+	upscaleShader.addShader(GL_COMPUTE_SHADER, "shaders/hdr_pass/upscale.comp.glsl");
+	sharpenShader.addShader(GL_COMPUTE_SHADER, "shaders/hdr_pass/sharpen.comp.glsl");
+
+	// Starts cleared, after that the average pass clears it every frame
+	const std::array<uint32_t, NUM_HISTOGRAM_BINS> histogram = { };
+	renderContext.buffers.bufferData("luminance_histogram", sizeof(histogram), histogram.data());
+
+	// Average luminance + exposure, starts at middle grey
+	const glm::vec2 exposure = { 0.18f, 1.0f };
+	renderContext.buffers.bufferData("exposure", sizeof(exposure), &exposure);
+
+	exposureTimer.start();
+}
+
+HDRRenderPass::~HDRRenderPass()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+
+	glDeleteFramebuffers(1, &outputFramebuffer);
+	glDeleteTextures(1, &outputTexture);
+
+	glDeleteTextures(1, &ldrTexture);
+	glDeleteTextures(1, &upscaledTexture);
 }
 
 void HDRRenderPass::frame()
 {
-	hdrPassShader.use();
+	PROFILE_SCOPE("HDRRenderPass::frame");
 
 	glActiveTexture(GL_TEXTURE0);
 
-	glBindTexture(GL_TEXTURE_2D, colourTexture);
+	// The HDR target, or the TAA resolve of it
+	glBindTexture(GL_TEXTURE_2D, renderContext.sceneColour);
+
+	if (autoExposure)
+	{
+		ScopedGPUProfile scope(renderContext.gpuProfiler, "Exposure");
+		computeExposure();
+	}
+
+	const bool bloomEnabled = renderContext.flags[BLOOM_ENABLED];
+	if (bloomEnabled)
+	{
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("bloom"));
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	// The upscaler works on tonemapped values, so it needs the compute path
+	const bool upscaling = isUpscaling();
+	if (useCompute || upscaling)
+	{
+		const glm::ivec2 tonemapDimensions = upscaling ? renderContext.sceneColourDimensions : renderContext.outputDimensions;
+
+		hdrPassComputeShader.use();
+		renderContext.buffers.bindBuffers(hdrPassComputeShader);
+
+		hdrPassComputeShader.setInt("uColourTexture", 0);
+		hdrPassComputeShader.setBool("uAutoExposure", autoExposure);
+		hdrPassComputeShader.setInt("uBloomTexture", 1);
+		hdrPassComputeShader.setBool("uBloomEnabled", bloomEnabled);
+		hdrPassComputeShader.setFloat("uBloomStrength", bloomStrength);
+		glUniform2i(hdrPassComputeShader.getLocation("uOutputDimensions"), tonemapDimensions.x, tonemapDimensions.y);
+
+		glBindImageTexture(0, upscaling ? ldrTexture : outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+		glDispatchCompute((tonemapDimensions.x + 7) / 8, (tonemapDimensions.y + 7) / 8, 1);
+
+		if (upscaling)
+		{
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+			ScopedGPUProfile scope(renderContext.gpuProfiler, "Upscale");
+			upscale();
+		}
+
+		glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+		glBlitNamedFramebuffer(outputFramebuffer, 0,
+			0, 0, renderContext.outputDimensions.x, renderContext.outputDimensions.y,
+			0, 0, renderContext.outputDimensions.x, renderContext.outputDimensions.y,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+		return;
+	}
+
+	hdrPassShader.use();
+	renderContext.buffers.bindBuffers(hdrPassShader);
 
 	hdrPassShader.setInt("uColourTexture", 0);
+	hdrPassShader.setBool("uAutoExposure", autoExposure);
+	hdrPassShader.setInt("uBloomTexture", 1);
+	hdrPassShader.setBool("uBloomEnabled", bloomEnabled);
+	hdrPassShader.setFloat("uBloomStrength", bloomStrength);
 
-	hdrPassShader.setVec2("uScreenDimensions", renderContext.dimensions);
+	hdrPassShader.setVec2("uScreenDimensions", renderContext.outputDimensions);
 
 	const auto& quadPrim = quad->getPrimitives()[0];
 
 	renderPrimitive(quadPrim);
 }
 
+void HDRRenderPass::computeExposure()
+{
+	exposureTimer.tick();
+
+	const glm::ivec2& dimensions = renderContext.sceneColourDimensions;
+
+	luminanceHistogramShader.use();
+	renderContext.buffers.bindBuffers(luminanceHistogramShader);
+
+	luminanceHistogramShader.setInt("uColourTexture", 0);
+	glUniform2i(luminanceHistogramShader.getLocation("uScreenDimensions"), dimensions.x, dimensions.y);
+	luminanceHistogramShader.setFloat("uMinLogLuminance", MIN_LOG_LUMINANCE);
+	luminanceHistogramShader.setFloat("uInverseLogLuminanceRange", 1.0f / (MAX_LOG_LUMINANCE - MIN_LOG_LUMINANCE));
+
+	glDispatchCompute((dimensions.x + 15) / 16, (dimensions.y + 15) / 16, 1);
+
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	exposureAverageShader.use();
+	renderContext.buffers.bindBuffers(exposureAverageShader);
+
+	glUniform1ui(exposureAverageShader.getLocation("uNumPixels"), static_cast<GLuint>(dimensions.x * dimensions.y));
+	exposureAverageShader.setFloat("uMinLogLuminance", MIN_LOG_LUMINANCE);
+	exposureAverageShader.setFloat("uLogLuminanceRange", MAX_LOG_LUMINANCE - MIN_LOG_LUMINANCE);
+	exposureAverageShader.setFloat("uDeltaTime", exposureTimer.getDeltaTime<Timer::f_seconds>().count());
+	exposureAverageShader.setFloat("uAdaptationRate", adaptationRate);
+
+	glDispatchCompute(1, 1, 1);
+
+	// The tonemap reads the exposure straight out of the buffer
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void HDRRenderPass::upscale()
+{
+	const glm::ivec2& dimensions = renderContext.outputDimensions;
+	const glm::ivec2 groups = (dimensions + 7) / 8;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, ldrTexture);
+
+	upscaleShader.use();
+	upscaleShader.setInt("uSourceTexture", 0);
+
+	// Without the sharpen the upsample can go straight to the output
+	glBindImageTexture(0, sharpen ? upscaledTexture : outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+	glDispatchCompute(groups.x, groups.y, 1);
+
+	if (!sharpen) return;
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, upscaledTexture);
+
+	sharpenShader.use();
+	sharpenShader.setInt("uSourceTexture", 0);
+	sharpenShader.setFloat("uSharpness", sharpness);
+
+	glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+	glDispatchCompute(groups.x, groups.y, 1);
+}
+
+bool HDRRenderPass::isUpscaling() const
+{
+	return spatialUpscaler && renderContext.sceneColourDimensions != renderContext.outputDimensions;
+}
+
+void HDRRenderPass::setVelocityOutput(bool velocityOutput)
+{
+	if (this->velocityOutput == velocityOutput) return;
+
+	this->velocityOutput = velocityOutput;
+
+	updateDrawBuffers();
+}
+
+void HDRRenderPass::setAmbientOutput(bool ambientOutput)
+{
+	if (this->ambientOutput == ambientOutput) return;
+
+	this->ambientOutput = ambientOutput;
+
+	updateDrawBuffers();
+}
+
+void HDRRenderPass::updateDrawBuffers()
+{
+	const std::array<GLenum, 3> drawBuffers = {
+		GL_COLOR_ATTACHMENT0,
+		velocityOutput ? static_cast<GLenum>(GL_COLOR_ATTACHMENT1) : static_cast<GLenum>(GL_NONE),
+		ambientOutput ? static_cast<GLenum>(GL_COLOR_ATTACHMENT2) : static_cast<GLenum>(GL_NONE)
+	};
+
+	glNamedFramebufferDrawBuffers(framebuffer, static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+}
+
 void HDRRenderPass::refresh()
 {
-	ScopedFramebufferBind framebufferBind(renderContext.framebufferStack, framebuffer);
+	allocateTargets();
+}
 
-	glBindRenderbuffer(GL_RENDERBUFFER, depthRenderBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT,
-		renderContext.dimensions.x, renderContext.dimensions.y);
+void HDRRenderPass::setFormat(HDRFormat format)
+{
+	this->format = format;
 
-	glBindTexture(GL_TEXTURE_2D, colourTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, renderContext.dimensions.x, renderContext.dimensions.y, 0, GL_RGBA, GL_FLOAT, 0);
+	allocateTargets();
 }
+
+size_t HDRRenderPass::getBytesPerPixel() const
+{
+	return hdrFormats[format].bytesPerPixel + DEPTH_BYTES_PER_PIXEL;
+}
+
+size_t HDRRenderPass::getEstimatedFrameBandwidth() const
+{
+	const size_t colourBytes = hdrFormats[format].bytesPerPixel;
+
+	// Forward pass: colour write + depth test and write. Tonemap: colour read. TAA: velocity write + read.
+	// SSAO: ambient write + read
+	const size_t hdrBytesPerPixel = colourBytes + 2 * DEPTH_BYTES_PER_PIXEL + colourBytes +
+		(velocityOutput ? 2 * VELOCITY_BYTES_PER_PIXEL : 0) + (ambientOutput ? 2 * colourBytes : 0);
+
+	const size_t hdrPixels = static_cast<size_t>(renderContext.dimensions.x) * static_cast<size_t>(renderContext.dimensions.y);
+	const size_t outputPixels = static_cast<size_t>(renderContext.outputDimensions.x) * static_cast<size_t>(renderContext.outputDimensions.y);
+
+	if (isUpscaling())
+	{
+		// Tonemap: LDR write at render size. Upscale: LDR read, write at window size (twice with the sharpen). Blit: read, write
+		const size_t ldrBytesPerPixel = (sharpen ? 6 : 4) * LDR_BYTES_PER_PIXEL;
+
+		return (hdrBytesPerPixel + LDR_BYTES_PER_PIXEL) * hdrPixels + ldrBytesPerPixel * outputPixels;
+	}
+
+	// Tonemap: LDR write, at window size. The compute path's blit reads and writes it again
+	const size_t ldrBytesPerPixel = useCompute ? 3 * LDR_BYTES_PER_PIXEL : LDR_BYTES_PER_PIXEL;
+
+	return hdrBytesPerPixel * hdrPixels + ldrBytesPerPixel * outputPixels;
+}
+
+void HDRRenderPass::allocateTargets()
+{
+	const HDRFormatDesc& formatDesc = hdrFormats[format];
+
+	// A texture rather than a renderbuffer so SSAO can read it
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, renderContext.dimensions.x, renderContext.dimensions.y, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+
+	// Linear for the bloom downsample, everything else reads it texel for texel
+	glBindTexture(GL_TEXTURE_2D, colourTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, formatDesc.internalFormat, renderContext.dimensions.x, renderContext.dimensions.y, 0, formatDesc.format, GL_FLOAT, 0);
+
+	glBindTexture(GL_TEXTURE_2D, velocityTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, renderContext.dimensions.x, renderContext.dimensions.y, 0, GL_RG, GL_FLOAT, 0);
+
+	glBindTexture(GL_TEXTURE_2D, ambientTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, formatDesc.internalFormat, renderContext.dimensions.x, renderContext.dimensions.y, 0, formatDesc.format, GL_FLOAT, 0);
+
+	glBindTexture(GL_TEXTURE_2D, outputTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderContext.outputDimensions.x, renderContext.outputDimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+	// The upscaler filters these itself, with texelFetch
+	for (const auto& [texture, dimensions] : { std::pair(ldrTexture, renderContext.dimensions), std::pair(upscaledTexture, renderContext.outputDimensions) })
+	{
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, colourTexture, 0);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT1, velocityTexture, 0);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT2, ambientTexture, 0);
+
+	updateDrawBuffers();
+
+	if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		throw std::runtime_error("Incomplete HDR Framebuffer!");
+	}
+
+	glNamedFramebufferTexture(outputFramebuffer, GL_COLOR_ATTACHMENT0, outputTexture, 0);
+	glNamedFramebufferReadBuffer(outputFramebuffer, GL_COLOR_ATTACHMENT0);
+
+	if (glCheckNamedFramebufferStatus(outputFramebuffer, GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::error("Incomplete HDR output framebuffer, falling back to the fragment tonemap");
+		useCompute = false;
+	}
+}
\ No newline at end of file
@@ -1,11 +1,24 @@
 #pragma once
 
 #include "renderPass.h"
+#include "timer.h"
+
+// Colour format of the HDR target, every forward pass write and blend pays for it
+enum HDRFormat : uint32_t {
+	HDR_FORMAT_R11G11B10F = 0,	// 4 bytes, no alpha or sign
+	HDR_FORMAT_RGBA16F,			// 8 bytes
+	HDR_FORMAT_RGBA32F,			// 16 bytes
+	NUM_HDR_FORMATS
+};
 
 class HDRRenderPass : public RenderPass
 {
 public:
 	HDRRenderPass(RenderContext& renderContext);
+	~HDRRenderPass();
+
+	HDRRenderPass(const HDRRenderPass&) = delete;
+	HDRRenderPass& operator=(const HDRRenderPass&) = delete;
 
 public:
 	// Inherited via RenderPass
@@ -14,12 +27,104 @@ public:
 
 	GLuint getFramebuffer() const { return framebuffer; }
 
+	// Whether the forward pass's motion vectors go anywhere, they're only needed for TAA
+	void setVelocityOutput(bool velocityOutput);
+
+	// Likewise its ambient lighting on its own, which only SSAO needs
+	void setAmbientOutput(bool ambientOutput);
+
+	HDRFormat getFormat() const { return format; }
+	void setFormat(HDRFormat format);
+
+	bool getUseCompute() const { return useCompute; }
+	void setUseCompute(bool useCompute) { this->useCompute = useCompute; }
+
+	bool getAutoExposure() const { return autoExposure; }
+	void setAutoExposure(bool autoExposure) { this->autoExposure = autoExposure; }
+
+	float getAdaptationRate() const { return adaptationRate; }
+	void setAdaptationRate(float adaptationRate) { this->adaptationRate = adaptationRate; }
+
+	// How much of the bloom texture is mixed in, when BLOOM_ENABLED
+	float getBloomStrength() const { return bloomStrength; }
+	void setBloomStrength(float bloomStrength) { this->bloomStrength = bloomStrength; }
+
+	// Window / render resolution the renderer should aim for, [1, 2]
+	float getUpscaleFactor() const { return upscaleFactor; }
+	void setUpscaleFactor(float upscaleFactor) { this->upscaleFactor = glm::clamp(upscaleFactor, 1.0f, 2.0f); }
+
+	// Edge adaptive upsample when rendering below window size, plain bilinear otherwise
+	bool getSpatialUpscaler() const { return spatialUpscaler; }
+	void setSpatialUpscaler(bool spatialUpscaler) { this->spatialUpscaler = spatialUpscaler; }
+
+	// Contrast adaptive sharpen after the upsample
+	bool getSharpen() const { return sharpen; }
+	void setSharpen(bool sharpen) { this->sharpen = sharpen; }
+
+	// [0, 1]
+	float getSharpness() const { return sharpness; }
+	void setSharpness(float sharpness) { this->sharpness = sharpness; }
+
+	// Bytes per pixel of the HDR colour + depth targets
+	size_t getBytesPerPixel() const;
+
+	// Rough bytes moved per frame through the HDR and output targets, assumes one write per pixel (no overdraw)
+	size_t getEstimatedFrameBandwidth() const;
+
+private:
+	void allocateTargets();
+
+	// Colour, plus velocity and ambient when they're wanted
+	void updateDrawBuffers();
+
+	// Histogram of the HDR target -> smoothed exposure, all on the GPU
+	void computeExposure();
+
+	// Tonemapped ldrTexture -> outputTexture, at window size
+	void upscale();
+
+	bool isUpscaling() const;
+
 private:
 	ShaderProgram hdrPassShader;
+	ShaderProgram hdrPassComputeShader;
+
+	ShaderProgram luminanceHistogramShader;
+	ShaderProgram exposureAverageShader;
+
+	ShaderProgram upscaleShader;
+	ShaderProgram sharpenShader;
+
+	HDRFormat format;
+	bool useCompute;
+
+	bool autoExposure;
+	float adaptationRate;
+
+	Timer exposureTimer;
+
+	float bloomStrength;
+
+	float upscaleFactor;
+	bool spatialUpscaler;
+	bool sharpen;
+	float sharpness;
 
 	GLuint framebuffer;
-	GLuint depthRenderBuffer;
+	GLuint depthTexture;
 	GLuint colourTexture;
+	GLuint velocityTexture;
+	bool velocityOutput;
+	GLuint ambientTexture; // The ambient part of colourTexture, same format
+	bool ambientOutput;
+
+	// LDR result of the compute path at window size, blitted to the screen
+	GLuint outputFramebuffer;
+	GLuint outputTexture;
+
+	// Tonemapped at render size, then upscaled (and sharpened) into the output
+	GLuint ldrTexture;
+	GLuint upscaledTexture;
 
 	const std::shared_ptr<RenderableModel> quad;
 };
\ No newline at end of file
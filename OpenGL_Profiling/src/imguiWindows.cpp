@@ -1,12 +1,197 @@
 #include "imguiWindows.h"
 
+#include <algorithm>
 #include <format>
+#include <string_view>
 
+#include "cpuProfiler.h"
+#include "frameHistory.h"
 #include "pbrRenderer.h"
 #include "timer.h"
 
+namespace
+{
+	constexpr float GRAPH_WIDTH = 480.0f;
+
+	// Budgets the frame graph is coloured by, 60 and 30 fps
+	constexpr float FAST_FRAME_MILLISECONDS = 1000.0f / 60.0f;
+	constexpr float SLOW_FRAME_MILLISECONDS = 1000.0f / 30.0f;
+
+	struct FlameBar
+	{
+		const char* name;
+		int depth;
+
+		// From the start of the frame
+		float startMilliseconds;
+		float endMilliseconds;
+	};
+
+	// Same colour for the same name, frame to frame
+	ImU32 getFlameColour(const char* name)
+	{
+		const size_t hash = std::hash<std::string_view>{}(name);
+
+		return ImColor::HSV(static_cast<float>(hash % 360) / 360.0f, 0.45f, 0.75f);
+	}
+
+	// Bars laid out by depth over [0, rangeMilliseconds], the name and time of the hovered one in a tooltip
+	void flameGraph(const char* id, const std::vector<FlameBar>& bars, float rangeMilliseconds)
+	{
+		int numRows = 1;
+		for (const FlameBar& bar : bars) numRows = std::max(numRows, bar.depth + 1);
+
+		const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		const ImVec2 size(GRAPH_WIDTH, rowHeight * static_cast<float>(numRows));
+
+		ImGui::InvisibleButton(id, size);
+
+		const bool hovered = ImGui::IsItemHovered();
+		const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 30, 255));
+
+		const FlameBar* hoveredBar = nullptr;
+
+		for (const FlameBar& bar : bars)
+		{
+			const float x0 = origin.x + bar.startMilliseconds / rangeMilliseconds * size.x;
+			const float x1 = std::max(origin.x + bar.endMilliseconds / rangeMilliseconds * size.x, x0 + 1.0f);
+			const float y0 = origin.y + static_cast<float>(bar.depth) * rowHeight;
+			const float y1 = y0 + rowHeight - 1.0f;
+
+			drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), getFlameColour(bar.name));
+
+			// Only where it fits
+			if (x1 - x0 > ImGui::CalcTextSize(bar.name).x + 4.0f)
+			{
+				drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(0, 0, 0, 255), bar.name);
+			}
+
+			if (hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1) hoveredBar = &bar;
+		}
+
+		if (hoveredBar)
+		{
+			ImGui::SetTooltip("%s\n%.3f ms", hoveredBar->name, hoveredBar->endMilliseconds - hoveredBar->startMilliseconds);
+		}
+	}
+
+	// Every frame in the history as a bar, clicking one pauses the history on it
+	void frameGraph(FrameHistory& history)
+	{
+		const ImVec2 origin = ImGui::GetCursorScreenPos();
+		const ImVec2 size(GRAPH_WIDTH, 80.0f);
+
+		ImGui::InvisibleButton("frameGraph", size);
+
+		const float barWidth = size.x / static_cast<float>(FrameHistory::WINDOW_SIZE);
+		const float topMilliseconds = std::max(history.getMax(), SLOW_FRAME_MILLISECONDS) * 1.1f;
+
+		const auto getY = [&](float milliseconds) { return origin.y + size.y * (1.0f - milliseconds / topMilliseconds); };
+
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 30, 255));
+
+		const std::optional<size_t> inspected = history.getInspectedFrame();
+
+		for (size_t i = 0; i < history.getNumFrames(); i++)
+		{
+			const float milliseconds = history.getFrame(i).milliseconds;
+
+			ImU32 colour = milliseconds <= FAST_FRAME_MILLISECONDS ? IM_COL32(90, 190, 90, 255) :
+				milliseconds <= SLOW_FRAME_MILLISECONDS ? IM_COL32(220, 190, 60, 255) : IM_COL32(220, 70, 60, 255);
+
+			if (history.isPaused() && inspected == i) colour = IM_COL32(255, 255, 255, 255);
+
+			const float x = origin.x + static_cast<float>(i) * barWidth;
+			drawList->AddRectFilled(ImVec2(x, getY(milliseconds)), ImVec2(x + std::max(barWidth - 1.0f, 1.0f), origin.y + size.y), colour);
+		}
+
+		drawList->AddLine(ImVec2(origin.x, getY(FAST_FRAME_MILLISECONDS)), ImVec2(origin.x + size.x, getY(FAST_FRAME_MILLISECONDS)), IM_COL32(255, 255, 255, 80));
+		drawList->AddLine(ImVec2(origin.x, getY(SLOW_FRAME_MILLISECONDS)), ImVec2(origin.x + size.x, getY(SLOW_FRAME_MILLISECONDS)), IM_COL32(255, 255, 255, 80));
+
+		if (!ImGui::IsItemHovered()) return;
+
+		const size_t hoveredFrame = static_cast<size_t>((ImGui::GetIO().MousePos.x - origin.x) / barWidth);
+		if (hoveredFrame >= history.getNumFrames()) return;
+
+		ImGui::SetTooltip("%.3f ms", history.getFrame(hoveredFrame).milliseconds);
 
-void metrics(Timer& timer, imgui_data& data)
+		if (ImGui::IsItemClicked()) history.select(hoveredFrame);
+	}
+
+	// The inspected frame's CPU zones, a row of bars per thread, over its GPU scopes on the same scale
+	void frameInspector(const FrameHistory& history)
+	{
+		const std::optional<size_t> inspected = history.getInspectedFrame();
+		if (!inspected) return;
+
+		const FrameHistory::Frame& frame = history.getFrame(*inspected);
+
+		uint64_t cpuStart = UINT64_MAX;
+		uint64_t cpuEnd = 0;
+
+		for (const auto& zone : frame.cpuZones)
+		{
+			cpuStart = std::min(cpuStart, zone.start);
+			cpuEnd = std::max(cpuEnd, zone.end);
+		}
+
+		const float cpuMilliseconds = frame.cpuZones.empty() ? 0.0f : static_cast<float>(cpuEnd - cpuStart) / 1000000.0f;
+		const float gpuMilliseconds = frame.gpuScopes.empty() ? 0.0f : frame.gpuScopes.front().getMilliseconds();
+
+		const float rangeMilliseconds = std::max({ cpuMilliseconds, gpuMilliseconds, 0.001f });
+
+		ImGui::Text("CPU: %.3f ms", cpuMilliseconds);
+
+		if (frame.cpuZones.empty())
+		{
+			ImGui::TextDisabled("Enable the CPU profiler to record zones");
+		}
+		else
+		{
+			const std::vector<std::string> threadNames = CPUProfiler::getThreadNames();
+
+			// Zones come ordered by thread
+			for (size_t first = 0; first < frame.cpuZones.size();)
+			{
+				const uint32_t thread = frame.cpuZones[first].thread;
+
+				std::vector<FlameBar> bars;
+
+				size_t last = first;
+				for (; last < frame.cpuZones.size() && frame.cpuZones[last].thread == thread; last++)
+				{
+					const auto& zone = frame.cpuZones[last];
+
+					bars.push_back({ zone.name, zone.depth,
+						static_cast<float>(zone.start - cpuStart) / 1000000.0f, static_cast<float>(zone.end - cpuStart) / 1000000.0f });
+				}
+
+				ImGui::TextDisabled("%s", thread < threadNames.size() ? threadNames[thread].c_str() : "Unknown");
+				flameGraph(std::format("cpuThread{}", thread).c_str(), bars, rangeMilliseconds);
+
+				first = last;
+			}
+		}
+
+		ImGui::Text("GPU: %.3f ms", gpuMilliseconds);
+
+		std::vector<FlameBar> bars;
+		for (const auto& scope : frame.gpuScopes)
+		{
+			bars.push_back({ scope.name.c_str(), scope.depth, scope.startMilliseconds, scope.endMilliseconds });
+		}
+
+		flameGraph("gpuScopes", bars, rangeMilliseconds);
+	}
+}
+
+void metrics(Timer& timer, imgui_data& data, PBRRenderer& renderer, FrameHistory& history)
 {
 	int windowFlags = ImGuiWindowFlags_NoResize | ImGuiWindowFlags_AlwaysAutoResize;
 
@@ -20,6 +205,43 @@ void metrics(Timer& timer, imgui_data& data)
 	timer.fixedTimeStep<std::ratio<1, 1>>([&]() { frametime = timer.getDeltaTime<Timer::f_mlliseconds>().count(); });
 
 	ImGui::Text("%.3f ms/frame | %.2f fps", frametime, 1.0f / (frametime / 1000.0f));
+	ImGui::Text("P50 %.2f | P95 %.2f | P99 %.2f | Max %.2f ms", history.getPercentile(0.5f), history.getPercentile(0.95f),
+		history.getPercentile(0.99f), history.getMax());
+
+	frameGraph(history);
+
+	if (history.isPaused())
+	{
+		if (ImGui::Button("Resume")) history.setPaused(false);
+		ImGui::SameLine();
+		ImGui::Text("Frame %zu of %zu", *history.getInspectedFrame() + 1, history.getNumFrames());
+	}
+	else
+	{
+		if (ImGui::Button("Pause")) history.setPaused(true);
+		ImGui::SameLine();
+		ImGui::TextDisabled("Click a frame to inspect it");
+	}
+
+	if (ImGui::CollapsingHeader("Frame Inspector", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		frameInspector(history);
+	}
+
+	renderer.imguiMetrics();
+
+	if (ImGui::CollapsingHeader("CPU Profiler"))
+	{
+		bool cpuProfiler = CPUProfiler::isEnabled();
+		if (ImGui::Checkbox("Enabled", &cpuProfiler)) CPUProfiler::setEnabled(cpuProfiler);
+
+		ImGui::SameLine();
+
+		if (CPUProfiler::isCapturing()) ImGui::Text("Capturing...");
+		else if (ImGui::Button("Capture 10 Frames")) CPUProfiler::capture(10, "captures/cpu_trace.json");
+
+		ImGui::Text("%zu zones last frame", CPUProfiler::getLatestFrame().size());
+	}
 
 	ImGui::End();
 }
@@ -3,7 +3,9 @@
 #include <imgui.h>
 
 class PBRRenderer_old;
+class PBRRenderer;
 class Timer;
+class FrameHistory;
 
 struct imgui_data
 {
@@ -14,5 +16,5 @@ struct imgui_data
 	bool showRenderDialog;
 };
 
-void metrics(Timer& timer, imgui_data& data);
+void metrics(Timer& timer, imgui_data& data, PBRRenderer& renderer, FrameHistory& history);
 void drawMenuBar(imgui_data& data);
\ No newline at end of file
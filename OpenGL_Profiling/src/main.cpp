@@ -28,11 +28,15 @@
 #include "imgui_impl_opengl3.h"
 
 #include "characterController.h"
+#include "cpuProfiler.h"
+#include "driverStats.h"
+#include "frameHistory.h"
 #include "inputHandler.h"
 #include "model.h"
 #include "orbitCamera.h"
 #include "pbrRenderer.h"
 #include "shaderProgram.h"
+#include "shaderWatcher.h"
 #include "timer.h"
 
 #include "imguiWindows.h"
@@ -104,6 +108,23 @@ int main()
 		return EXIT_FAILURE;
 	}
 
+	// Counts every pass's draws, binds and uploads for the metrics window
+	DriverStats::install();
+
+	// Lets programs compile on the driver's threads and be polled, instead of stalling their first use
+	if (glfwExtensionSupported("GL_KHR_parallel_shader_compile") || glfwExtensionSupported("GL_ARB_parallel_shader_compile"))
+	{
+		using MaxShaderCompilerThreads = void (APIENTRY*)(GLuint count);
+
+		auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreads>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+		if (!maxShaderCompilerThreads) maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreads>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+
+		// Some drivers only go parallel once asked to
+		if (maxShaderCompilerThreads) maxShaderCompilerThreads(0xFFFFFFFF);
+
+		ShaderProgram::setParallelCompile(true);
+	}
+
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -118,6 +139,8 @@ int main()
 
 	imgui_data imguiData;
 
+	CPUProfiler::setThreadName("Main");
+
 	// Successfully loaded OpenGL
 	spdlog::info("Loaded OpenGL {}.{}", GLVersion.major, GLVersion.minor);
 
@@ -155,6 +178,15 @@ int main()
 	//PBRRenderer_old renderer(glm::ivec2(WIDTH, HEIGHT), std::make_shared<OrbitCamera>(std::move(orbitCamera)));
 	PBRRenderer renderer(glm::ivec2(WIDTH, HEIGHT), std::make_shared<OrbitCamera>(std::move(orbitCamera)));
 
+	// Every pass's programs compile while the models load
+	ShaderProgram::compilePending();
+
+	// Edits to the shaders are picked up without restarting
+	ShaderWatcher shaderWatcher("shaders");
+	bool recompileHeld = false;
+
+	FrameHistory frameHistory;
+
 	std::vector<std::string> modelPaths = {
 		"C:\\Users\\Niall Townley\\Documents\\Source\\Viper\\Models\\Sponza\\glTF\\Sponza.gltf"
 		//"C:\\Users\\Niall Townley\\Documents\\Source\\Viper\\Models\\Statue\\greek-slave-plaster-cast-150k-4096-web.gltf",
@@ -259,6 +291,12 @@ int main()
 	{
 		t.tick();
 
+		// Collects last frame's zones, before this one's opens. The tick just measured that frame too
+		CPUProfiler::endFrame();
+		frameHistory.record(t.getDeltaTime<Timer::f_mlliseconds>().count(), CPUProfiler::getLatestFrame(), renderer.getGPUProfiler().getLatestFrame());
+
+		PROFILE_SCOPE("Frame");
+
 		userPtr.scroll = 0.0f;
 
 		glfwPollEvents();
@@ -269,7 +307,7 @@ int main()
 		ImGui::NewFrame();
 
 		drawMenuBar(imguiData);
-		if (imguiData.showMetrics) { metrics(t, imguiData); }
+		if (imguiData.showMetrics) { metrics(t, imguiData, renderer, frameHistory); }
 		if (imguiData.showCharacterInfo) { character.showInfo(imguiData); }
 		if (imguiData.showRenderDialog) { renderer.imguiFrame(imguiData); }
 
@@ -303,6 +341,17 @@ int main()
 			renderer.setCamera(character.getCameraPtr());
 		}
 
+		// R rebuilds everything, in case the watcher missed something
+		if (input.getAction("recompile") && !recompileHeld) ShaderProgram::reloadAll();
+		recompileHeld = input.getAction("recompile");
+
+		const auto changedShaders = shaderWatcher.takeChanges();
+		if (!changedShaders.empty()) ShaderProgram::reloadChanged(changedShaders);
+
+		// Anything created since, e.g. new permutations and reloads
+		ShaderProgram::compilePending();
+		ShaderProgram::swapReloaded();
+
 		renderer.frame();
 
 		ImGui::Render();
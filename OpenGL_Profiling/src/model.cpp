@@ -1,4 +1,5 @@
 #include "model.h"
+#include "cpuProfiler.h"
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
@@ -12,6 +13,8 @@
 RawModel::RawModel(std::filesystem::path gltfPath, std::string rootNode)
 	: rootNode(rootNode)
 {
+	PROFILE_SCOPE("RawModel::RawModel");
+
 	model.emplace();
 
 	tinygltf::TinyGLTF loader;
@@ -46,6 +49,8 @@ RawModel::RawModel(std::filesystem::path gltfPath, std::string rootNode)
 RenderableModel::RenderableModel(const LoadedModel& modelData, bool isStatic)
 	: rootNode(modelData.rootNode), transformation(std::make_shared<TransformNode>()), isStatic(isStatic)
 {
+	PROFILE_SCOPE("RenderableModel::RenderableModel");
+
 	loadBuffers(modelData.model);
 
 	loadTextures(modelData.model);
@@ -0,0 +1,128 @@
+#include "overdrawRenderPass.h"
+
+OverdrawRenderPass::OverdrawRenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext), maxOverdraw(8)
+{
+	countShader.addShader(GL_VERTEX_SHADER, "shaders/overdraw_pass/overdraw.vert.glsl");
+	countShader.addShader(GL_FRAGMENT_SHADER, "shaders/overdraw_pass/overdraw_count.frag.glsl");
+
+	heatmapShader.addShader(GL_COMPUTE_SHADER, "shaders/overdraw_pass/overdraw_heatmap.comp.glsl");
+
+	glGenFramebuffers(1, &framebuffer);
+	glGenTextures(1, &countTexture);
+	glGenTextures(1, &depthTexture);
+
+	glGenFramebuffers(1, &outputFramebuffer);
+	glGenTextures(1, &outputTexture);
+
+	allocateTargets();
+}
+
+OverdrawRenderPass::~OverdrawRenderPass()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteTextures(1, &countTexture);
+	glDeleteTextures(1, &depthTexture);
+
+	glDeleteFramebuffers(1, &outputFramebuffer);
+	glDeleteTextures(1, &outputTexture);
+}
+
+void OverdrawRenderPass::frame()
+{
+	PROFILE_SCOPE("OverdrawRenderPass::frame");
+
+	{
+		ScopedFramebufferBind framebufferBind(renderContext.framebufferStack, framebuffer);
+
+		glViewport(0, 0, renderContext.dimensions.x, renderContext.dimensions.y);
+
+		const float noFragments = 0.0f;
+		glClearBufferfv(GL_COLOR, 0, &noFragments);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_ONE, GL_ONE);
+
+		countShader.use();
+		renderContext.buffers.bindBuffers(countShader);
+
+		// Opaque then translucent, as the forward pass draws them. No sorting and no depth prepass, like it
+		for (const bool translucent : { false, true })
+		{
+			for (const auto& model : renderContext.scene->sceneModels)
+			{
+				const auto& prims = translucent ? model->getTranslucentPrimitives() : model->getOpaquePrimitives();
+				if (prims.empty()) continue;
+
+				loadJoints(model);
+
+				for (const auto& prim : prims)
+				{
+					renderPrimitive(prim);
+				}
+			}
+		}
+
+		glDisable(GL_BLEND);
+	}
+
+	glViewport(0, 0, renderContext.outputDimensions.x, renderContext.outputDimensions.y);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, countTexture);
+
+	heatmapShader.use();
+	heatmapShader.setInt("uOverdrawTexture", 0);
+	heatmapShader.setInt("uMaxOverdraw", maxOverdraw);
+
+	glBindImageTexture(0, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+	glDispatchCompute((renderContext.outputDimensions.x + 7) / 8, (renderContext.outputDimensions.y + 7) / 8, 1);
+
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+
+	glBlitNamedFramebuffer(outputFramebuffer, 0,
+		0, 0, renderContext.outputDimensions.x, renderContext.outputDimensions.y,
+		0, 0, renderContext.outputDimensions.x, renderContext.outputDimensions.y,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void OverdrawRenderPass::refresh()
+{
+	allocateTargets();
+}
+
+void OverdrawRenderPass::allocateTargets()
+{
+	// Read texel for texel, a filtered count would be a fraction of a fragment
+	glBindTexture(GL_TEXTURE_2D, countTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, renderContext.dimensions.x, renderContext.dimensions.y, 0, GL_RED, GL_FLOAT, 0);
+
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, renderContext.dimensions.x, renderContext.dimensions.y, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 0);
+
+	glBindTexture(GL_TEXTURE_2D, outputTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderContext.outputDimensions.x, renderContext.outputDimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+	glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, countTexture, 0);
+
+	if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		throw std::runtime_error("Incomplete Overdraw Framebuffer!");
+	}
+
+	glNamedFramebufferTexture(outputFramebuffer, GL_COLOR_ATTACHMENT0, outputTexture, 0);
+	glNamedFramebufferReadBuffer(outputFramebuffer, GL_COLOR_ATTACHMENT0);
+}
\ No newline at end of file
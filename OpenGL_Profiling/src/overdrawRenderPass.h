@@ -0,0 +1,42 @@
+#pragma once
+
+#include "renderPass.h"
+
+// Debug view of the forward pass's overdraw. Its geometry is drawn in the same order with a shader that outputs 1,
+// blended additively, so the target ends up holding how many fragments were shaded per pixel. Shown as a heatmap
+// in place of the forward pass and everything after it
+class OverdrawRenderPass : public RenderPass
+{
+public:
+	OverdrawRenderPass(RenderContext& renderContext);
+	~OverdrawRenderPass();
+
+	OverdrawRenderPass(const OverdrawRenderPass&) = delete;
+	OverdrawRenderPass& operator=(const OverdrawRenderPass&) = delete;
+
+public:
+	// Counts at render size, heatmap at window size straight to the screen
+	void frame() override;
+	void refresh() override;
+
+	// Count the heatmap reaches white at
+	int getMaxOverdraw() const { return maxOverdraw; }
+	void setMaxOverdraw(int maxOverdraw) { this->maxOverdraw = glm::max(maxOverdraw, 2); }
+
+private:
+	void allocateTargets();
+
+private:
+	ShaderProgram countShader;
+	ShaderProgram heatmapShader;
+
+	int maxOverdraw;
+
+	// Integer targets can't blend, counts are whole numbers in a float one instead (exact up to 2^24)
+	GLuint framebuffer;
+	GLuint countTexture;
+	GLuint depthTexture;
+
+	GLuint outputFramebuffer;
+	GLuint outputTexture;
+};
\ No newline at end of file
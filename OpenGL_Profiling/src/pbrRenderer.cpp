@@ -4,12 +4,19 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
 PBRRenderer::PBRRenderer(glm::ivec2 screenSize, std::shared_ptr<Camera> camera)
 	: renderContext()
 {
 	renderContext.nearPlane = 0.001f;
 	renderContext.farPlane = 100.0f;
 	renderContext.dimensions = screenSize;
+	renderContext.outputDimensions = screenSize;
 	renderContext.scene = std::make_shared<Scene>();
 
 	this->camera = camera;
@@ -21,21 +28,44 @@ PBRRenderer::PBRRenderer(glm::ivec2 screenSize, std::shared_ptr<Camera> camera)
 	renderContext.flags[RenderFlags::EMULATE_SUN_ENABLED] = false;
 	renderContext.flags[RenderFlags::DEFERRED_PASS_ENABLED] = false;
 	renderContext.flags[RenderFlags::HDR_PASS_ENABLED] = false;
+	renderContext.flags[RenderFlags::BLOOM_ENABLED] = false;
+	renderContext.flags[RenderFlags::TAA_ENABLED] = false;
+	renderContext.flags[RenderFlags::SSAO_ENABLED] = false;
+	renderContext.flags[RenderFlags::REFLECTION_PROBES_ENABLED] = false;
+	renderContext.flags[RenderFlags::OVERDRAW_VIEW_ENABLED] = false;
 
+	// create the required uniform buffers, before the passes as some of them fill their own
+	renderContext.buffers.addBuffer("frame_uniforms", GL_UNIFORM_BUFFER, "FrameUniformsBuffer");
+	renderContext.buffers.addBuffer("point_lights", GL_SHADER_STORAGE_BUFFER, "PointLightBuffer");
+	renderContext.buffers.addBuffer("directional_lights", GL_SHADER_STORAGE_BUFFER, "DirectionalLightBuffer");
+	renderContext.buffers.addBuffer("point_shadows", GL_SHADER_STORAGE_BUFFER, "PointShadowBuffer");
+	renderContext.buffers.addBuffer("reflection_probes", GL_SHADER_STORAGE_BUFFER, "ReflectionProbeBuffer");
+	renderContext.buffers.addBuffer("joints", GL_SHADER_STORAGE_BUFFER, "JointsBuffer");
+	renderContext.buffers.addBuffer("previous_joints", GL_SHADER_STORAGE_BUFFER, "PreviousJointsBuffer");
+	renderContext.buffers.addBuffer("object", GL_UNIFORM_BUFFER, "ObjectBuffer");
+	renderContext.buffers.addBuffer("luminance_histogram", GL_SHADER_STORAGE_BUFFER, "LuminanceHistogramBuffer");
+	renderContext.buffers.addBuffer("exposure", GL_SHADER_STORAGE_BUFFER, "ExposureBuffer");
+
+	environmentPass = std::make_shared<EnvironmentRenderPass>(renderContext);
+	shadowPass = std::make_shared<ShadowRenderPass>(renderContext);
+	reflectionProbePass = std::make_shared<ReflectionProbeRenderPass>(renderContext);
 	forwardPass = std::make_shared<ForwardRenderPass>(renderContext);
 	hdrPass = std::make_shared<HDRRenderPass>(renderContext);	
+	bloomPass = std::make_shared<BloomRenderPass>(renderContext);
+	taaPass = std::make_shared<TAARenderPass>(renderContext);
+	ssaoPass = std::make_shared<SSAORenderPass>(renderContext);
+	overdrawPass = std::make_shared<OverdrawRenderPass>(renderContext);
 
 	renderPasses.resize(NUM_PASSES);
+	renderPasses[ENVIRONMENT_PASS] = environmentPass;
+	renderPasses[SHADOW_PASS] = shadowPass;
+	renderPasses[REFLECTION_PROBE_PASS] = reflectionProbePass;
 	renderPasses[FORWARD_PASS] = forwardPass;
+	renderPasses[SSAO_PASS] = ssaoPass;
+	renderPasses[TAA_PASS] = taaPass;
+	renderPasses[BLOOM_PASS] = bloomPass;
 	renderPasses[HDR_PASS] = hdrPass;
-
-	// create the required uniform buffers
-	renderContext.buffers.addBuffer("flags", GL_UNIFORM_BUFFER, "FlagsBuffer");
-	renderContext.buffers.addBuffer("frame_uniforms", GL_UNIFORM_BUFFER, "FrameUniformsBuffer");
-	renderContext.buffers.addBuffer("point_lights", GL_SHADER_STORAGE_BUFFER, "PointLightBuffer");
-	renderContext.buffers.addBuffer("directional_lights", GL_SHADER_STORAGE_BUFFER, "DirectionalLightBuffer");
-	renderContext.buffers.addBuffer("joints", GL_SHADER_STORAGE_BUFFER, "JointsBuffer");
-	renderContext.buffers.addBuffer("object", GL_UNIFORM_BUFFER, "ObjectBuffer");
+	renderPasses[OVERDRAW_PASS] = overdrawPass;
 }
 
 PBRRenderer::~PBRRenderer()
@@ -49,6 +79,8 @@ PBRRenderer::~PBRRenderer()
 void PBRRenderer::loadScene(std::shared_ptr<Scene> scene)
 {
 	renderContext.scene = scene;
+
+	renderContext.flags[ENVIRONMENT_MAP_ENABLED] = !scene->environmentMap.empty() && environmentPass->loadEnvironment(scene->environmentMap);
 }
 
 void PBRRenderer::clearScene()
@@ -63,7 +95,25 @@ void PBRRenderer::setCamera(std::shared_ptr<Camera> camera)
 
 void PBRRenderer::resize(glm::ivec2 screenSize)
 {
-	renderContext.dimensions = screenSize;
+	renderContext.outputDimensions = screenSize;
+
+	updateRenderDimensions();
+}
+
+glm::ivec2 PBRRenderer::calculateRenderDimensions() const
+{
+	// Anything below window size needs the HDR pass to upscale it
+	if (!renderContext.flags[HDR_PASS_ENABLED]) return renderContext.outputDimensions;
+
+	const float scale = dynamicResolution.getScale() / hdrPass->getUpscaleFactor();
+	const glm::vec2 scaled = glm::vec2(renderContext.outputDimensions) * scale;
+
+	return glm::max(glm::ivec2(glm::round(scaled)), glm::ivec2(1));
+}
+
+void PBRRenderer::updateRenderDimensions()
+{
+	renderContext.dimensions = calculateRenderDimensions();
 
 	for (auto& pass : renderPasses)
 	{
@@ -85,34 +135,646 @@ void PBRRenderer::imguiFrame(imgui_data& data)
 	ImGui::Separator();
 
 	ImGui::Text("Flags");
+
+	ImGui::Checkbox("Overdraw View", &renderContext.flags[RenderFlags::OVERDRAW_VIEW_ENABLED]);
+
+	if (renderContext.flags[RenderFlags::OVERDRAW_VIEW_ENABLED])
+	{
+		int maxOverdraw = overdrawPass->getMaxOverdraw();
+		if (ImGui::SliderInt("Max Overdraw", &maxOverdraw, 2, 32)) overdrawPass->setMaxOverdraw(maxOverdraw);
+
+		ImGui::TextDisabled("Fragments per pixel: 1 blue, green, yellow, red, %d+ white", maxOverdraw);
+	}
+
 	ImGui::Checkbox("HDR Pass Enabled", &renderContext.flags[RenderFlags::HDR_PASS_ENABLED]);
 
+	if (renderContext.flags[RenderFlags::HDR_PASS_ENABLED])
+	{
+		const char* hdrFormats[] = { "R11G11B10F", "RGBA16F", "RGBA32F" };
+
+		int hdrFormat = static_cast<int>(hdrPass->getFormat());
+		if (ImGui::Combo("HDR Format", &hdrFormat, hdrFormats, NUM_HDR_FORMATS))
+		{
+			hdrPass->setFormat(static_cast<HDRFormat>(hdrFormat));
+		}
+
+		bool autoExposure = hdrPass->getAutoExposure();
+		if (ImGui::Checkbox("Auto Exposure", &autoExposure))
+		{
+			hdrPass->setAutoExposure(autoExposure);
+		}
+
+		if (autoExposure)
+		{
+			float adaptationRate = hdrPass->getAdaptationRate();
+			if (ImGui::SliderFloat("Adaptation Rate", &adaptationRate, 0.1f, 10.0f))
+			{
+				hdrPass->setAdaptationRate(adaptationRate);
+			}
+		}
+
+		ImGui::Checkbox("Bloom Enabled", &renderContext.flags[RenderFlags::BLOOM_ENABLED]);
+
+		if (renderContext.flags[RenderFlags::BLOOM_ENABLED])
+		{
+			float bloomStrength = hdrPass->getBloomStrength();
+			if (ImGui::SliderFloat("Bloom Strength", &bloomStrength, 0.0f, 0.5f))
+			{
+				hdrPass->setBloomStrength(bloomStrength);
+			}
+
+			float bloomRadius = bloomPass->getFilterRadius();
+			if (ImGui::SliderFloat("Bloom Filter Radius", &bloomRadius, 0.5f, 4.0f))
+			{
+				bloomPass->setFilterRadius(bloomRadius);
+			}
+		}
+
+		ImGui::Checkbox("SSAO Enabled", &renderContext.flags[RenderFlags::SSAO_ENABLED]);
+
+		if (renderContext.flags[RenderFlags::SSAO_ENABLED])
+		{
+			float ssaoRadius = ssaoPass->getRadius();
+			if (ImGui::SliderFloat("SSAO Radius", &ssaoRadius, 0.05f, 2.0f))
+			{
+				ssaoPass->setRadius(ssaoRadius);
+			}
+
+			float ssaoStrength = ssaoPass->getStrength();
+			if (ImGui::SliderFloat("SSAO Strength", &ssaoStrength, 0.0f, 1.0f))
+			{
+				ssaoPass->setStrength(ssaoStrength);
+			}
+		}
+
+		ImGui::Checkbox("TAA Enabled", &renderContext.flags[RenderFlags::TAA_ENABLED]);
+
+		if (renderContext.flags[RenderFlags::TAA_ENABLED])
+		{
+			float blendFactor = taaPass->getBlendFactor();
+			if (ImGui::SliderFloat("TAA Blend Factor", &blendFactor, 0.02f, 0.5f))
+			{
+				taaPass->setBlendFactor(blendFactor);
+			}
+
+			// Takes over from the spatial upscaler, the TAA resolve is already at window size
+			bool temporalUpsampling = taaPass->getTemporalUpsampling();
+			if (ImGui::Checkbox("Temporal Upsampling", &temporalUpsampling))
+			{
+				taaPass->setTemporalUpsampling(temporalUpsampling);
+			}
+		}
+
+		bool useCompute = hdrPass->getUseCompute();
+		if (ImGui::Checkbox("Compute Tonemap", &useCompute))
+		{
+			hdrPass->setUseCompute(useCompute);
+		}
+
+		float upscaleFactor = hdrPass->getUpscaleFactor();
+		if (ImGui::SliderFloat("Upscale Factor", &upscaleFactor, 1.0f, 2.0f, "%.2fx"))
+		{
+			hdrPass->setUpscaleFactor(upscaleFactor);
+		}
+
+		if (upscaleFactor > 1.0f || dynamicResolution.getEnabled())
+		{
+			bool spatialUpscaler = hdrPass->getSpatialUpscaler();
+			if (ImGui::Checkbox("Spatial Upscaler", &spatialUpscaler))
+			{
+				hdrPass->setSpatialUpscaler(spatialUpscaler);
+			}
+
+			if (spatialUpscaler)
+			{
+				bool sharpen = hdrPass->getSharpen();
+				if (ImGui::Checkbox("Sharpen", &sharpen))
+				{
+					hdrPass->setSharpen(sharpen);
+				}
+
+				float sharpness = hdrPass->getSharpness();
+				if (sharpen && ImGui::SliderFloat("Sharpness", &sharpness, 0.0f, 1.0f))
+				{
+					hdrPass->setSharpness(sharpness);
+				}
+			}
+		}
+
+		bool dynamicResolutionEnabled = dynamicResolution.getEnabled();
+		if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolutionEnabled))
+		{
+			dynamicResolution.setEnabled(dynamicResolutionEnabled);
+		}
+
+		if (dynamicResolutionEnabled)
+		{
+			float targetMilliseconds = dynamicResolution.getTargetMilliseconds();
+			if (ImGui::SliderFloat("Target GPU Time (ms)", &targetMilliseconds, 2.0f, 50.0f))
+			{
+				dynamicResolution.setTargetMilliseconds(targetMilliseconds);
+			}
+
+			float minScale = dynamicResolution.getMinScale();
+			if (ImGui::SliderFloat("Min Render Scale", &minScale, 0.25f, 1.0f))
+			{
+				dynamicResolution.setMinScale(minScale);
+			}
+
+			ImGui::Text("Render Scale: %.2f (%dx%d), GPU %.2f ms", dynamicResolution.getScale(),
+				renderContext.dimensions.x, renderContext.dimensions.y, dynamicResolution.getSmoothedMilliseconds());
+		}
+
+		const float frameMegabytes = static_cast<float>(hdrPass->getEstimatedFrameBandwidth()) / (1024.0f * 1024.0f);
+
+		ImGui::Text("HDR Target: %zu bytes/pixel", hdrPass->getBytesPerPixel());
+		ImGui::Text("Est. Bandwidth: %.1f MB/frame, %.2f GB/s", frameMegabytes, frameMegabytes * ImGui::GetIO().Framerate / 1024.0f);
+	}
+
+	if (environmentPass->hasEnvironment())
+	{
+		ImGui::Checkbox("Environment Enabled", &renderContext.flags[RenderFlags::ENVIRONMENT_MAP_ENABLED]);
+
+		if (environmentPass->isImporting())
+		{
+			ImGui::SameLine();
+			ImGui::Text("(importing...)");
+		}
+
+		const SunEstimate& sun = renderContext.environmentSun;
+		if (renderContext.flags[RenderFlags::ENVIRONMENT_MAP_ENABLED] && sun.found)
+		{
+			ImGui::Checkbox("Emulate Sun", &renderContext.flags[RenderFlags::EMULATE_SUN_ENABLED]);
+
+			ImGui::Text("Sun Direction: %.2f %.2f %.2f", sun.direction.x, sun.direction.y, sun.direction.z);
+			ImGui::Text("Sun Irradiance: %.2f %.2f %.2f", sun.irradiance.r, sun.irradiance.g, sun.irradiance.b);
+		}
+
+		// Local specular on top of the environment's
+		if (renderContext.flags[RenderFlags::ENVIRONMENT_MAP_ENABLED])
+		{
+			ImGui::Checkbox("Reflection Probes Enabled", &renderContext.flags[RenderFlags::REFLECTION_PROBES_ENABLED]);
+		}
+
+		if (renderContext.flags[RenderFlags::ENVIRONMENT_MAP_ENABLED] && renderContext.flags[RenderFlags::REFLECTION_PROBES_ENABLED])
+		{
+			float budget = reflectionProbePass->getBudgetMilliseconds();
+			if (ImGui::SliderFloat("Probe Update Budget (ms)", &budget, 0.1f, 4.0f))
+			{
+				reflectionProbePass->setBudgetMilliseconds(budget);
+			}
+
+			if (ImGui::Button("Add Probe At Camera"))
+			{
+				const glm::vec3 eye = camera->getEye();
+				renderContext.scene->reflectionProbes.push_back({ eye, eye - glm::vec3(2.0f), eye + glm::vec3(2.0f), 0.5f });
+			}
+
+			ImGui::SameLine();
+
+			if (ImGui::Button("Recapture Probes"))
+			{
+				reflectionProbePass->invalidate();
+			}
+
+			ImGui::Text("Probes: %d / %d ready, %d steps/frame", reflectionProbePass->getNumReadyProbes(),
+				reflectionProbePass->getNumProbes(), reflectionProbePass->getStepsPerFrame());
+		}
+	}
+
+	ImGui::Checkbox("Shadows Enabled", &renderContext.flags[RenderFlags::SHADOWS_ENABLED]);
+
+	if (renderContext.flags[RenderFlags::SHADOWS_ENABLED])
+	{
+		const char* pointShadowModes[] = { "Cubemap (6 views)", "Tetrahedral (4 views)", "Dual Paraboloid (2 views)" };
+
+		int pointShadowMode = static_cast<int>(renderContext.pointShadowMode);
+		if (ImGui::Combo("Point Shadow Mode", &pointShadowMode, pointShadowModes, NUM_POINT_SHADOW_MODES))
+		{
+			renderContext.pointShadowMode = static_cast<PointShadowMode>(pointShadowMode);
+		}
+
+		const char* atlasSizes[] = { "1024", "2048", "4096", "8192" };
+
+		int atlasSize = static_cast<int>(std::log2(shadowPass->getShadowAtlasDimensions())) - 10;
+		if (ImGui::Combo("Shadow Atlas Dimensions", &atlasSize, atlasSizes, IM_ARRAYSIZE(atlasSizes)))
+		{
+			shadowPass->setShadowAtlasDimensions(1024 << atlasSize);
+		}
+
+		ImGui::Text("Shadow Atlas Usage: %.1f%%", shadowPass->getShadowAtlasUsage() * 100.0f);
+	}
+
 	ImGui::End();
 }
 
+void PBRRenderer::imguiMetrics()
+{
+	ImGui::Text("GPU: %.3f ms/frame", renderContext.gpuProfiler.getLatestMilliseconds("Frame"));
+	ImGui::Text("Forward Permutations: %zu, %zu programs compiling", forwardPass->getNumPermutations(), ShaderProgram::getNumCompiling());
+
+	if (ImGui::CollapsingHeader("GPU Profiler", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		imguiGPUProfiler();
+
+		GPUProfiler& profiler = renderContext.gpuProfiler;
+
+		if (profiler.supportsPipelineStatistics())
+		{
+			bool pipelineStatistics = profiler.getPipelineStatistics();
+			if (ImGui::Checkbox("Pipeline Statistics", &pipelineStatistics)) profiler.setPipelineStatistics(pipelineStatistics);
+
+			if (pipelineStatistics) imguiPipelineStatistics();
+		}
+		else
+		{
+			ImGui::TextDisabled("Pipeline statistics unsupported");
+		}
+	}
+
+	if (ImGui::CollapsingHeader("Driver Stats"))
+	{
+		imguiDriverStats();
+
+		if (ImGui::Button("Export Pass Stats"))
+		{
+			const std::filesystem::path path = "captures/pass_stats.csv";
+			if (exportPassStats(path)) spdlog::info("Wrote pass stats: {}", path.string());
+		}
+	}
+
+	if (renderContext.flags[HDR_PASS_ENABLED] && renderContext.flags[BLOOM_ENABLED] &&
+		ImGui::CollapsingHeader("Bloom (GPU)"))
+	{
+		const GPUProfiler& profiler = renderContext.gpuProfiler;
+		float total = 0.0f;
+
+		for (int mip = 0; mip < bloomPass->getNumMips(); mip++)
+		{
+			const glm::ivec2 dimensions = bloomPass->getMipDimensions(mip);
+			const float downsample = profiler.getLatestMilliseconds(std::format("Frame/Bloom/Downsample {}", mip));
+
+			// The smallest mip is never upsampled from, so has no scope and reads 0
+			const float upsample = profiler.getLatestMilliseconds(std::format("Frame/Bloom/Upsample {}", mip));
+
+			ImGui::Text("Mip %d (%dx%d): down %.3f ms | up %.3f ms", mip, dimensions.x, dimensions.y, downsample, upsample);
+
+			total += downsample + upsample;
+		}
+
+		ImGui::Text("Total: %.3f ms", total);
+	}
+}
+
+void PBRRenderer::imguiGPUProfiler()
+{
+	if (!ImGui::BeginTable("gpuProfiler", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+	{
+		return;
+	}
+
+	ImGui::TableSetupColumn("Scope");
+	ImGui::TableSetupColumn("Last");
+	ImGui::TableSetupColumn("Avg");
+	ImGui::TableSetupColumn("P50");
+	ImGui::TableSetupColumn("P95");
+	ImGui::TableSetupColumn("P99");
+	ImGui::TableHeadersRow();
+
+	for (const auto& scope : renderContext.gpuProfiler.getLatestFrame())
+	{
+		const ProfileStats* stats = renderContext.gpuProfiler.getStats(scope.path);
+		if (!stats) continue;
+
+		ImGui::TableNextRow();
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%*s%s", scope.depth * 2, "", scope.name.c_str());
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", scope.getMilliseconds());
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", stats->getAverage());
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", stats->getPercentile(0.5f));
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", stats->getPercentile(0.95f));
+		ImGui::TableNextColumn();
+		ImGui::Text("%.3f", stats->getPercentile(0.99f));
+	}
+
+	ImGui::EndTable();
+}
+
+void PBRRenderer::imguiDriverStats()
+{
+	if (!ImGui::BeginTable("driverStats", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+	{
+		return;
+	}
+
+	ImGui::TableSetupColumn("Pass");
+	ImGui::TableSetupColumn("Draws");
+	ImGui::TableSetupColumn("Dispatches");
+	ImGui::TableSetupColumn("Triangles");
+	ImGui::TableSetupColumn("Programs");
+	ImGui::TableSetupColumn("Textures");
+	ImGui::TableSetupColumn("Buffers");
+	ImGui::TableSetupColumn("FBOs");
+	ImGui::TableSetupColumn("Uploaded");
+	ImGui::TableHeadersRow();
+
+	const auto row = [](const std::string& name, const DriverCounters& counters)
+		{
+			ImGui::TableNextRow();
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%s", name.c_str());
+
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", counters.drawCalls);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", counters.dispatches);
+			ImGui::TableNextColumn();
+			ImGui::Text("%llu", static_cast<unsigned long long>(counters.triangles));
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", counters.programSwitches);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", counters.textureBinds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", counters.bufferBinds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", counters.framebufferSwitches);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f KB", static_cast<float>(counters.bytesUploaded) / 1024.0f);
+		};
+
+	DriverCounters total;
+
+	for (const auto& pass : DriverStats::getLatestFrame())
+	{
+		row(pass.name, pass.counters);
+		total += pass.counters;
+	}
+
+	row("Total", total);
+
+	ImGui::EndTable();
+}
+
+void PBRRenderer::imguiPipelineStatistics()
+{
+	if (!ImGui::BeginTable("pipelineStatistics", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+	{
+		return;
+	}
+
+	ImGui::TableSetupColumn("Pass");
+	ImGui::TableSetupColumn("VS Invocations");
+	ImGui::TableSetupColumn("Clip In");
+	ImGui::TableSetupColumn("Clip Out");
+	ImGui::TableSetupColumn("FS Invocations");
+	ImGui::TableSetupColumn("FS / Pixel");
+	ImGui::TableHeadersRow();
+
+	const double numPixels = static_cast<double>(renderContext.dimensions.x) * static_cast<double>(renderContext.dimensions.y);
+
+	for (const auto& scope : renderContext.gpuProfiler.getLatestFrame())
+	{
+		if (!scope.statistics) continue;
+
+		const PipelineStatistics& statistics = *scope.statistics;
+
+		ImGui::TableNextRow();
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%s", scope.name.c_str());
+
+		ImGui::TableNextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(statistics.vertexShaderInvocations));
+		ImGui::TableNextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(statistics.clippingInputPrimitives));
+		ImGui::TableNextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(statistics.clippingOutputPrimitives));
+		ImGui::TableNextColumn();
+		ImGui::Text("%llu", static_cast<unsigned long long>(statistics.fragmentShaderInvocations));
+
+		// Overdraw, for passes that draw at render size. Includes helper invocations along triangle edges
+		ImGui::TableNextColumn();
+		ImGui::Text("%.2f", static_cast<double>(statistics.fragmentShaderInvocations) / numPixels);
+	}
+
+	ImGui::EndTable();
+}
+
+bool PBRRenderer::exportPassStats(const std::filesystem::path& path) const
+{
+	std::error_code error;
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		spdlog::error("Failed to write pass stats: {}", path.string());
+		return false;
+	}
+
+	file << "pass,gpu_avg_ms,gpu_p50_ms,gpu_p95_ms,gpu_p99_ms,draw_calls,dispatches,primitives,triangles,"
+		"program_switches,texture_binds,buffer_binds,framebuffer_switches,bytes_uploaded,"
+		"vs_invocations,clipping_input_primitives,clipping_output_primitives,fs_invocations\n";
+
+	const auto& scopes = renderContext.gpuProfiler.getLatestFrame();
+
+	for (const auto& pass : DriverStats::getLatestFrame())
+	{
+		file << pass.name << ",";
+
+		// Passes are timed as children of the frame scope. "Other" isn't timed
+		if (const ProfileStats* stats = renderContext.gpuProfiler.getStats("Frame/" + pass.name))
+		{
+			file << std::format("{:.4f},{:.4f},{:.4f},{:.4f},", stats->getAverage(), stats->getPercentile(0.5f),
+				stats->getPercentile(0.95f), stats->getPercentile(0.99f));
+		}
+		else
+		{
+			file << ",,,,";
+		}
+
+		const DriverCounters& counters = pass.counters;
+
+		file << std::format("{},{},{},{},{},{},{},{},{},", counters.drawCalls, counters.dispatches, counters.primitives, counters.triangles,
+			counters.programSwitches, counters.textureBinds, counters.bufferBinds, counters.framebufferSwitches, counters.bytesUploaded);
+
+		// Only while pipeline statistics are on
+		const auto scope = std::find_if(scopes.begin(), scopes.end(), [&](const auto& scope) { return scope.path == "Frame/" + pass.name; });
+
+		if (scope != scopes.end() && scope->statistics)
+		{
+			const PipelineStatistics& statistics = *scope->statistics;
+
+			file << std::format("{},{},{},{}\n", statistics.vertexShaderInvocations, statistics.clippingInputPrimitives,
+				statistics.clippingOutputPrimitives, statistics.fragmentShaderInvocations);
+		}
+		else
+		{
+			file << ",,,\n";
+		}
+	}
+
+	return true;
+}
+
 void PBRRenderer::frame()
 {
+	PROFILE_SCOPE("PBRRenderer::frame");
+
+	// Scaling needs the HDR pass to upscale to the window, TAA and SSAO need its targets
+	if (dynamicResolution.getEnabled() && !renderContext.flags[HDR_PASS_ENABLED])
+	{
+		dynamicResolution.setEnabled(false);
+	}
+
+	if (!renderContext.flags[HDR_PASS_ENABLED])
 	{
+		renderContext.flags[TAA_ENABLED] = false;
+		renderContext.flags[SSAO_ENABLED] = false;
+	}
+
+	// The whole frame's scope, a few frames old once resolved
+	dynamicResolution.update(renderContext.gpuProfiler.getLatestMilliseconds("Frame"));
+
+	// Catches the scale changing as well as the upscale factor and HDR toggles from the dialog
+	if (calculateRenderDimensions() != renderContext.dimensions)
+	{
+		updateRenderDimensions();
+	}
+
+	GPUProfiler& profiler = renderContext.gpuProfiler;
+
+	profiler.beginFrame();
+	DriverStats::beginFrame();
+
+	// Before the buffers, a finished import changes the SH
+	{
+		ScopedGPUProfile scope(profiler, "Environment");
+		ScopedDriverStats passStats("Environment");
+		environmentPass->frame();
+	}
+
+	{
+		ScopedGPUProfile scope(profiler, "Buffers");
+		ScopedDriverStats passStats("Buffers");
+		buildBuffers();
+	}
+
+	if (renderContext.flags[SHADOWS_ENABLED])
+	{
+		ScopedGPUProfile scope(profiler, "Shadows");
+		ScopedDriverStats passStats("Shadows");
+		shadowPass->frame();
+	}
+
+	// Captures are lit like the forward pass, so after the shadows
+	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED] && renderContext.flags[REFLECTION_PROBES_ENABLED])
+	{
+		ScopedGPUProfile scope(profiler, "Reflection Probes");
+		ScopedDriverStats passStats("Reflection Probes");
+		reflectionProbePass->frame();
+	}
+
+	// Debug view, in place of the forward pass and everything after it
+	if (renderContext.flags[OVERDRAW_VIEW_ENABLED])
+	{
+		{
+			ScopedGPUProfile scope(profiler, "Overdraw");
+			ScopedDriverStats passStats("Overdraw");
+			overdrawPass->frame();
+		}
+
+		profiler.endFrame();
+
+		return;
+	}
+
+	hdrPass->setVelocityOutput(renderContext.flags[TAA_ENABLED]);
+	hdrPass->setAmbientOutput(renderContext.flags[SSAO_ENABLED]);
+
+	{
+		ScopedGPUProfile scope(profiler, "Forward");
+		ScopedDriverStats passStats("Forward");
+
 		ScopedFramebufferBind framebufferBind(renderContext.framebufferStack,
 			renderContext.flags[HDR_PASS_ENABLED] ? hdrPass->getFramebuffer() : 0);
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		glViewport(0, 0, renderContext.dimensions.x, renderContext.dimensions.y);
+		// Nothing drawn = nothing moved
+		if (renderContext.flags[TAA_ENABLED])
+		{
+			const glm::vec4 noVelocity(0.0f);
+			glClearBufferfv(GL_COLOR, 1, glm::value_ptr(noVelocity));
+		}
 
-		buildBuffers();
+		// Nor has any ambient light to occlude
+		if (renderContext.flags[SSAO_ENABLED])
+		{
+			const glm::vec4 noAmbient(0.0f);
+			glClearBufferfv(GL_COLOR, 2, glm::value_ptr(noAmbient));
+		}
+
+		glViewport(0, 0, renderContext.dimensions.x, renderContext.dimensions.y);
 
 		forwardPass->frame();
 	}
 
-	glViewport(0, 0, renderContext.dimensions.x, renderContext.dimensions.y);
+	if (renderContext.flags[SSAO_ENABLED])
+	{
+		ScopedGPUProfile scope(profiler, "SSAO");
+		ScopedDriverStats passStats("SSAO");
+		ssaoPass->frame();
+	}
+
+	glViewport(0, 0, renderContext.outputDimensions.x, renderContext.outputDimensions.y);
 
 	if (renderContext.flags[HDR_PASS_ENABLED])
-	{ hdrPass->frame(); }
+	{
+		renderContext.sceneColour = renderContext.textures.at("hdrColour");
+		renderContext.sceneColourDimensions = renderContext.dimensions;
+
+		if (renderContext.flags[TAA_ENABLED])
+		{
+			ScopedGPUProfile scope(profiler, "TAA");
+			ScopedDriverStats passStats("TAA");
+			taaPass->frame();
+		}
+
+		if (renderContext.flags[BLOOM_ENABLED])
+		{
+			ScopedGPUProfile scope(profiler, "Bloom");
+			ScopedDriverStats passStats("Bloom");
+			bloomPass->frame();
+		}
+
+		ScopedGPUProfile scope(profiler, "HDR");
+		ScopedDriverStats passStats("HDR");
+		hdrPass->frame();
+	}
+
+	profiler.endFrame();
 }
 
 void PBRRenderer::buildBuffers()
 {
+	PROFILE_SCOPE("PBRRenderer::buildBuffers");
+
+	// Last frame's transforms become the motion vector history, the passes fill in this frame's as they draw
+	std::swap(renderContext.modelMatrices, renderContext.previousModelMatrices);
+	std::swap(renderContext.jointMatrices, renderContext.previousJointMatrices);
+	renderContext.modelMatrices.clear();
+	renderContext.jointMatrices.clear();
+
+	renderContext.previousViewProjectionMatrix = renderContext.projectionMatrix * renderContext.viewMatrix;
+
 	std::vector<PointLight> pointLights;
 	std::vector<DirectionalLight> directionalLights;
 
@@ -139,25 +801,59 @@ void PBRRenderer::buildBuffers()
 		}
 	}
 
-	std::array<uint32_t, RenderFlags::NUM_FLAGS> spacedFlags;
-	for (int i = 0; i < RenderFlags::NUM_FLAGS; i++) spacedFlags[i] = static_cast<uint32_t>(renderContext.flags[i]);
+	// The environment's sun as a real light, so it gets specular highlights. Like any directional light it casts no shadow
+	const bool emulateSun = renderContext.flags[EMULATE_SUN_ENABLED] && renderContext.flags[ENVIRONMENT_MAP_ENABLED] &&
+		renderContext.environmentSun.found;
 
-	renderContext.buffers.bufferData("flags", sizeof(uint32_t) * RenderFlags::NUM_FLAGS, spacedFlags.data());
+	if (emulateSun)
+	{
+		directionalLights.push_back(
+			{
+				glm::vec4(renderContext.environmentSun.direction, 0.0f),
+				glm::vec4(renderContext.environmentSun.irradiance, 1.0f)
+			}
+		);
+	}
 
 	FrameUniforms frameUniforms = { };
 
-	frameUniforms.projectionMatrix = glm::perspective(
+	renderContext.projectionMatrix = glm::perspective(
 		glm::radians(camera->getFov()),
 		static_cast<float>(renderContext.dimensions.x) / static_cast<float>(renderContext.dimensions.y),
 		renderContext.nearPlane, renderContext.farPlane);
 
-	frameUniforms.viewMatrix = camera->getViewMatrix();
+	renderContext.viewMatrix = camera->getViewMatrix();
+
+	// Sub-pixel offset baked into the projection the shaders see, the context keeps the unjittered one
+	renderContext.jitter = renderContext.flags[TAA_ENABLED] ? taaPass->getJitter() : glm::vec2(0.0f);
+	const glm::vec2 jitterNDC = 2.0f * renderContext.jitter / glm::vec2(renderContext.dimensions);
+
+	frameUniforms.projectionMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(jitterNDC, 0.0f)) * renderContext.projectionMatrix;
+	frameUniforms.viewMatrix = renderContext.viewMatrix;
+	frameUniforms.previousViewProjectionMatrix = renderContext.previousViewProjectionMatrix;
 	frameUniforms.cameraPosition = camera->getEye();
 	frameUniforms.directionalShadowCascadePlanes = { 0.05f, 0.1f, 0.25f, 0.5f }; // todo: add cascade shadow planes
 	frameUniforms.pointShadowNearPlane = renderContext.nearPlane;
 	frameUniforms.pointShadowFarPlane = renderContext.farPlane;
+	frameUniforms.jitter = jitterNDC;
 	frameUniforms.numPointLights = static_cast<int>(pointLights.size());
 	frameUniforms.numDirectionalLights = static_cast<int>(directionalLights.size());
+	frameUniforms.pointShadowMode = static_cast<int>(renderContext.pointShadowMode);
+
+	// Otherwise the sun would be counted twice, as a light and in the diffuse
+	SphericalHarmonics irradianceSH = renderContext.irradianceSH;
+	if (emulateSun)
+	{
+		SphericalHarmonics sunSH = convolveIrradiance(
+			projectDirectional(renderContext.environmentSun.direction, renderContext.environmentSun.irradiance));
+
+		irradianceSH += (sunSH *= -1.0f);
+	}
+
+	for (size_t i = 0; i < NUM_SH_COEFFICIENTS; i++)
+	{
+		frameUniforms.irradianceSH[i] = glm::vec4(irradianceSH.coefficients[i], 0.0f);
+	}
 
 	renderContext.buffers.bufferData("frame_uniforms", sizeof(FrameUniforms), &frameUniforms);
 	renderContext.buffers.bufferData("point_lights", sizeof(PointLight) * pointLights.size(), pointLights.data());
@@ -1,11 +1,21 @@
 #pragma once
 
 #include "renderPass.h"
+#include "environmentRenderPass.h"
 #include "forwardRenderPass.h"
 #include "hdrRenderPass.h"
+#include "bloomRenderPass.h"
+#include "taaRenderPass.h"
+#include "ssaoRenderPass.h"
+#include "shadowRenderPass.h"
+#include "reflectionProbeRenderPass.h"
+#include "overdrawRenderPass.h"
+#include "dynamicResolution.h"
 #include "camera.h"
 #include "imguiWindows.h"
 
+#include <filesystem>
+
 class PBRRenderer
 {
 public:
@@ -25,11 +35,32 @@ public:
 	void resize(glm::ivec2 screenSize);
 
 	void imguiFrame(imgui_data& data);
+	void imguiMetrics();
 	void frame();
 
+	const GPUProfiler& getGPUProfiler() const { return renderContext.gpuProfiler; }
+
 private:
 	void buildBuffers();
 
+	// Per scope last / average / percentile times of the GPU profiler
+	void imguiGPUProfiler();
+
+	// Per pass draw calls, binds and uploads from last frame
+	void imguiDriverStats();
+
+	// Per pass counters of the GPU profiler's latest frame, while pipeline statistics are on
+	void imguiPipelineStatistics();
+
+	// The driver stats of last frame's passes beside their GPU times, as CSV
+	bool exportPassStats(const std::filesystem::path& path) const;
+
+	// Internal resolution from the window size, render scale and upscale factor
+	glm::ivec2 calculateRenderDimensions() const;
+
+	// Applies calculateRenderDimensions, refreshes the passes
+	void updateRenderDimensions();
+
 private:
 	struct PointLight
 	{
@@ -41,13 +72,17 @@ private:
 	{
 		glm::vec4 direction; // X Y Z + padding
 		glm::vec4 radiance; // R G B + padding
-		std::array<glm::vec4, NUM_CASCADES> lightSpaceMatrices; // 4 * 4 * 5 = 80 bytes
+		std::array<glm::mat4, NUM_CASCADES> lightSpaceMatrices; // 4 * 16 * 5 = 320 bytes
 	};
 
+	// Matches the std430 DirectionalLight in uniforms_common.glsl, the array stride included
+	static_assert(sizeof(DirectionalLight) == 16 + 16 + 64 * NUM_CASCADES);
+
 	struct alignas(16) FrameUniforms
 	{
 		glm::mat4 projectionMatrix;
 		glm::mat4 viewMatrix;
+		glm::mat4 previousViewProjectionMatrix;
 		glm::vec3 cameraPosition;
 		float pad0;
 
@@ -56,8 +91,14 @@ private:
 		float pointShadowNearPlane;
 		float pointShadowFarPlane;
 
+		glm::vec2 jitter; // NDC
+
 		int numPointLights;
 		int numDirectionalLights;
+
+		int pointShadowMode;
+
+		alignas(16) std::array<glm::vec4, NUM_SH_COEFFICIENTS> irradianceSH; // RGB + padding
 	};
 
 private:
@@ -65,18 +106,32 @@ private:
 
 	std::shared_ptr<Camera> camera;
 
+	DynamicResolution dynamicResolution;
+
 	enum : uint8_t
 	{
-		//ENVIRONMENT_PASS = 0,
-		//SHADOW_PASS,
+		ENVIRONMENT_PASS = 0,
+		SHADOW_PASS,
+		REFLECTION_PROBE_PASS,
 		//DEFERRED_PASS,
-		FORWARD_PASS = 0,
+		FORWARD_PASS,
+		SSAO_PASS,
+		TAA_PASS,
+		BLOOM_PASS,
 		HDR_PASS,
+		OVERDRAW_PASS,
 		NUM_PASSES
 	};
 
+	std::shared_ptr<EnvironmentRenderPass> environmentPass;
+	std::shared_ptr<ShadowRenderPass> shadowPass;
+	std::shared_ptr<ReflectionProbeRenderPass> reflectionProbePass;
 	std::shared_ptr<HDRRenderPass> hdrPass;
+	std::shared_ptr<BloomRenderPass> bloomPass;
+	std::shared_ptr<TAARenderPass> taaPass;
+	std::shared_ptr<SSAORenderPass> ssaoPass;
 	std::shared_ptr<ForwardRenderPass> forwardPass;
+	std::shared_ptr<OverdrawRenderPass> overdrawPass;
 
 	std::vector<std::shared_ptr<RenderPass>> renderPasses;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "programBinaryCache.h"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+#include <fstream>
+#include <format>
+#include <limits>
+#include <vector>
+
+namespace
+{
+	// Bump whenever the file layout changes
+	constexpr uint32_t PROGRAM_BINARY_CACHE_VERSION = 1;
+
+	const std::filesystem::path PROGRAM_BINARY_CACHE_DIRECTORY = "cache/shaders";
+
+	struct ProgramBinaryHeader
+	{
+		uint32_t version;
+		GLenum binaryFormat;
+		uint64_t key; // Guards against a renamed or truncated file
+		uint64_t length;
+	};
+
+	std::filesystem::path getCachePath(uint64_t key)
+	{
+		return PROGRAM_BINARY_CACHE_DIRECTORY / std::format("{:016x}.bin", key);
+	}
+
+	// Drivers that report no binary formats can't load anything back, don't bother writing
+	bool isSupported()
+	{
+		static const bool supported = []()
+			{
+				GLint formats = 0;
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+				return formats > 0;
+			}();
+
+		return supported;
+	}
+}
+
+uint64_t hashString(std::string_view string, uint64_t seed)
+{
+	uint64_t hash = seed;
+
+	for (const char c : string)
+	{
+		hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+uint64_t getProgramBinaryKey()
+{
+	static const uint64_t key = []()
+		{
+			uint64_t hash = hashString(std::to_string(PROGRAM_BINARY_CACHE_VERSION));
+
+			for (const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+			{
+				const auto* value = reinterpret_cast<const char*>(glGetString(name));
+				hash = hashString(value ? value : "", hash);
+			}
+
+			return hash;
+		}();
+
+	return key;
+}
+
+bool loadProgramBinary(GLuint program, uint64_t key)
+{
+	if (!isSupported()) return false;
+
+	const std::filesystem::path path = getCachePath(key);
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	ProgramBinaryHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		header.version != PROGRAM_BINARY_CACHE_VERSION || header.key != key)
+	{
+		spdlog::warn("Ignoring unexpected program binary: {}", path.string());
+		return false;
+	}
+
+	// Checked against what's actually left in the file before allocating, a corrupt length could be anything
+	std::error_code error;
+	const uintmax_t fileSize = std::filesystem::file_size(path, error);
+	if (error || header.length > fileSize - sizeof(header) || header.length > static_cast<uint64_t>(std::numeric_limits<GLsizei>::max()))
+	{
+		spdlog::warn("Ignoring truncated program binary: {}", path.string());
+		return false;
+	}
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size()))
+	{
+		spdlog::warn("Ignoring truncated program binary: {}", path.string());
+		return false;
+	}
+
+	glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+
+	// Drivers are free to reject binaries from older versions of themselves, relinking overwrites the file
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		spdlog::info("Driver rejected program binary: {}", path.string());
+		return false;
+	}
+
+	return true;
+}
+
+void saveProgramBinary(GLuint program, uint64_t key)
+{
+	if (!isSupported()) return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	ProgramBinaryHeader header = { PROGRAM_BINARY_CACHE_VERSION, 0, key, static_cast<uint64_t>(length) };
+
+	std::vector<char> binary(length);
+	glGetProgramBinary(program, length, nullptr, &header.binaryFormat, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(PROGRAM_BINARY_CACHE_DIRECTORY, error);
+
+	const std::filesystem::path path = getCachePath(key);
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), binary.size()))
+	{
+		spdlog::warn("Failed to write program binary: {}", path.string());
+	}
+}
\ No newline at end of file
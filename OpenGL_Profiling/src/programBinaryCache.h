@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string_view>
+
+// Linked program binaries on disk, so startup (and every new permutation after the first run) skips
+// compiling and linking. Keyed by everything the driver compiled, the binaries are only valid for the
+// exact driver that produced them, which getProgramBinaryKey folds in
+
+// FNV-1a, chainable: pass the previous result as the seed to hash several strings as one
+uint64_t hashString(std::string_view string, uint64_t seed = 0xCBF29CE484222325ull);
+
+// Seed for hashing a program's preprocessed sources, covers the GL vendor, renderer and version
+uint64_t getProgramBinaryKey();
+
+// False if there is no binary for this key or the driver rejected it, the program then needs linking from source
+bool loadProgramBinary(GLuint program, uint64_t key);
+
+// Program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void saveProgramBinary(GLuint program, uint64_t key);
\ No newline at end of file
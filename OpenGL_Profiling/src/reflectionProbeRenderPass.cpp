@@ -0,0 +1,417 @@
+#include "reflectionProbeRenderPass.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+
+constexpr int MAX_REFLECTION_PROBES = 16;
+
+constexpr int PROBE_DIMENSIONS = 128;
+constexpr int PROBE_MIPS = 5; // Same roughness -> mip mapping as the environment's prefiltered map, MAX_REFLECTION_LOD in pbr.glsl
+
+// Six face captures, then a prefilter dispatch per mip
+constexpr int PROBE_STEPS = 6 + PROBE_MIPS;
+
+constexpr float CAPTURE_NEAR_PLANE = 0.05f;
+
+constexpr float STEP_COST_SMOOTHING = 0.1f;
+
+// GL cubemap face order, same orientation as getCubemapDirection in cubemap_common.glsl
+static const std::array<glm::vec3, 6> captureDirections = {
+	glm::vec3( 1.0f,  0.0f,  0.0f),
+	glm::vec3(-1.0f,  0.0f,  0.0f),
+	glm::vec3( 0.0f,  1.0f,  0.0f),
+	glm::vec3( 0.0f, -1.0f,  0.0f),
+	glm::vec3( 0.0f,  0.0f,  1.0f),
+	glm::vec3( 0.0f,  0.0f, -1.0f)
+};
+
+static const std::array<glm::vec3, 6> captureUps = {
+	glm::vec3(0.0f, -1.0f,  0.0f),
+	glm::vec3(0.0f, -1.0f,  0.0f),
+	glm::vec3(0.0f,  0.0f,  1.0f),
+	glm::vec3(0.0f,  0.0f, -1.0f),
+	glm::vec3(0.0f, -1.0f,  0.0f),
+	glm::vec3(0.0f, -1.0f,  0.0f)
+};
+
+ReflectionProbeRenderPass::ReflectionProbeRenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext),
+	// The forward pass's shading, seen from the probe
+	capturePermutations({
+		{ GL_VERTEX_SHADER, "shaders/probe_pass/probe_capture.vert.glsl" },
+		{ GL_FRAGMENT_SHADER, "shaders/forward_pass/forward_pass.frag.glsl" }
+	}, FORWARD_FEATURE_NAMES),
+	probes(), lightingSignature(0),
+	updatingProbe(-1), probeStep(0), lastProbe(-1),
+	budgetMilliseconds(1.0f), smoothedStepMilliseconds(0.0f), stepsPerFrame(0), updatePath()
+{
+	skyShader.addShader(GL_COMPUTE_SHADER, "shaders/probe_pass/probe_sky.comp.glsl");
+
+	createTextures();
+}
+
+ReflectionProbeRenderPass::~ReflectionProbeRenderPass()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &captureDepth);
+
+	glDeleteTextures(1, &captureCubemap);
+	glDeleteTextures(static_cast<GLsizei>(probeViews.size()), probeViews.data());
+}
+
+void ReflectionProbeRenderPass::frame()
+{
+	PROFILE_SCOPE("ReflectionProbeRenderPass::frame");
+
+	syncProbes();
+
+	// Geometry changes aren't tracked, anything moving the static scene should invalidate() itself
+	const size_t signature = getLightingSignature();
+	if (signature != lightingSignature)
+	{
+		lightingSignature = signature;
+		invalidate();
+	}
+
+	// Faces cost more than mips and the profiler lags a few frames, the average is only a rough guide
+	const float updateMilliseconds = renderContext.gpuProfiler.getLatestMilliseconds(updatePath);
+
+	if (stepsPerFrame > 0 && updateMilliseconds > 0.0f)
+	{
+		const float stepMilliseconds = updateMilliseconds / static_cast<float>(stepsPerFrame);
+
+		smoothedStepMilliseconds = smoothedStepMilliseconds > 0.0f ?
+			smoothedStepMilliseconds + (stepMilliseconds - smoothedStepMilliseconds) * STEP_COST_SMOOTHING :
+			stepMilliseconds;
+	}
+
+	// Always at least one step, so even a tiny budget converges
+	const int maxSteps = smoothedStepMilliseconds > 0.0f ?
+		std::clamp(static_cast<int>(budgetMilliseconds / smoothedStepMilliseconds), 1, PROBE_STEPS) : 1;
+
+	stepsPerFrame = 0;
+
+	if (updatingProbe < 0) updatingProbe = pickProbe();
+
+	if (updatingProbe >= 0)
+	{
+		ScopedGPUProfile scope(renderContext.gpuProfiler, "Update");
+		updatePath = scope.getPath();
+
+		while (updatingProbe >= 0 && stepsPerFrame < maxSteps)
+		{
+			stepsPerFrame++;
+
+			if (advanceProbe())
+			{
+				lastProbe = updatingProbe;
+				updatingProbe = pickProbe();
+			}
+		}
+
+		glViewport(0, 0, renderContext.dimensions.x, renderContext.dimensions.y);
+	}
+
+	uploadProbes();
+}
+
+void ReflectionProbeRenderPass::refresh()
+{
+	// Nothing depends on the screen size
+}
+
+void ReflectionProbeRenderPass::invalidate()
+{
+	for (auto& state : probes)
+	{
+		state.dirty = true;
+	}
+}
+
+int ReflectionProbeRenderPass::getNumReadyProbes() const
+{
+	return static_cast<int>(std::count_if(probes.begin(), probes.end(), [](const ProbeState& state) { return state.ready; }));
+}
+
+void ReflectionProbeRenderPass::syncProbes()
+{
+	const auto& sceneProbes = renderContext.scene->reflectionProbes;
+
+	// Any past the array's size are ignored
+	const size_t numProbes = std::min(sceneProbes.size(), static_cast<size_t>(MAX_REFLECTION_PROBES));
+
+	probes.resize(numProbes, { ReflectionProbe(), false, true });
+
+	for (size_t i = 0; i < numProbes; i++)
+	{
+		ProbeState& state = probes[i];
+		const ReflectionProbe& probe = sceneProbes[i];
+
+		if (state.probe == probe) continue;
+
+		// Slots go by index, so after an insert or remove this may be a different probe altogether.
+		// Only the blend distance changing leaves the capture right for it
+		const bool moved = state.probe.position != probe.position || state.probe.boxMin != probe.boxMin || state.probe.boxMax != probe.boxMax;
+
+		state.probe = probe;
+
+		if (!moved) continue;
+
+		// The old capture would show the wrong place, so it's hidden until the new one is done
+		state.ready = false;
+		state.dirty = true;
+
+		if (updatingProbe == static_cast<int>(i)) probeStep = 0;
+	}
+
+	if (updatingProbe >= static_cast<int>(numProbes))
+	{
+		updatingProbe = -1;
+		probeStep = 0;
+	}
+}
+
+size_t ReflectionProbeRenderPass::getLightingSignature() const
+{
+	size_t signature = 0;
+
+	const auto combine = [&signature](auto value)
+	{
+		signature ^= std::hash<decltype(value)>()(value) + 0x9e3779b9 + (signature << 6) + (signature >> 2);
+	};
+
+	for (const auto& light : renderContext.scene->sceneLights)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			combine(light.position[i]);
+			combine(light.colour[i]);
+		}
+
+		combine(light.strength);
+		combine(static_cast<int>(light.type));
+	}
+
+	// Replaced whenever an import finishes
+	const auto environment = renderContext.textures.find("prefilteredMap");
+	combine(environment != renderContext.textures.end() ? environment->second : 0u);
+
+	combine(renderContext.flags[ENVIRONMENT_MAP_ENABLED]);
+	combine(renderContext.flags[EMULATE_SUN_ENABLED]);
+	combine(renderContext.flags[SHADOWS_ENABLED]);
+
+	return signature;
+}
+
+int ReflectionProbeRenderPass::pickProbe() const
+{
+	const int numProbes = static_cast<int>(probes.size());
+
+	for (int i = 0; i < numProbes; i++)
+	{
+		if (!probes[i].ready) return i;
+	}
+
+	for (int offset = 1; offset <= numProbes; offset++)
+	{
+		const int i = (lastProbe + offset) % numProbes;
+		if (probes[i].dirty) return i;
+	}
+
+	return -1;
+}
+
+bool ReflectionProbeRenderPass::advanceProbe()
+{
+	ProbeState& state = probes[updatingProbe];
+
+	// Anything invalidating it from here on needs another capture
+	if (probeStep == 0) state.dirty = false;
+
+	if (probeStep < 6)
+	{
+		if (probeStep == 0) fillSky();
+
+		captureFace(probeStep);
+	}
+	else
+	{
+		const int mip = probeStep - 6;
+
+		if (mip == 0) glGenerateTextureMipmap(captureCubemap);
+
+		// Straight into the live slot, a ready probe blends from its old capture to the new one a mip at a time
+		prefilter.prefilterMip(captureCubemap, probeViews[updatingProbe], PROBE_DIMENSIONS, mip, PROBE_MIPS);
+	}
+
+	if (++probeStep < PROBE_STEPS) return false;
+
+	probeStep = 0;
+	state.ready = true;
+
+	return true;
+}
+
+void ReflectionProbeRenderPass::fillSky()
+{
+	skyShader.use();
+	skyShader.setInt("uPrefilteredMap", 0);
+	skyShader.setBool("uEnvironmentEnabled", renderContext.flags[ENVIRONMENT_MAP_ENABLED]);
+
+	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED])
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, renderContext.textures.at("prefilteredMap"));
+	}
+
+	glBindImageTexture(0, captureCubemap, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	glDispatchCompute((PROBE_DIMENSIONS + 7) / 8, (PROBE_DIMENSIONS + 7) / 8, 6);
+
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT);
+}
+
+void ReflectionProbeRenderPass::captureFace(int face)
+{
+	const glm::vec3 position = probes[updatingProbe].probe.position;
+
+	const glm::mat4 projection = glm::perspective(glm::half_pi<float>(), 1.0f, CAPTURE_NEAR_PLANE, renderContext.farPlane);
+	const glm::mat4 view = glm::lookAt(position, position + captureDirections[face], captureUps[face]);
+
+	glNamedFramebufferTextureLayer(framebuffer, GL_COLOR_ATTACHMENT0, captureCubemap, 0, face);
+
+	ScopedFramebufferBind framebufferBind(renderContext.framebufferStack, framebuffer);
+
+	glViewport(0, 0, PROBE_DIMENSIONS, PROBE_DIMENSIONS);
+
+	// The sky is already in the colour
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	if (renderContext.flags[SHADOWS_ENABLED])
+	{
+		glActiveTexture(GL_TEXTURE5);
+		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("shadowAtlas"));
+	}
+
+	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED])
+	{
+		glActiveTexture(GL_TEXTURE8);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, renderContext.textures.at("prefilteredMap"));
+
+		glActiveTexture(GL_TEXTURE9);
+		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("brdf"));
+	}
+
+	// Probes don't see each other and nothing here writes velocity
+	const ShaderFeatures captureFeatures = (getFrameFeatures() & ~((1u << FEATURE_REFLECTION_PROBES) | (1u << FEATURE_TAA)))
+		| (1u << FEATURE_PROBE_CAPTURE);
+
+	ShaderProgram* boundProgram = nullptr;
+
+	// Opaque only, translucent surfaces are too small a part of a reflection to be worth the blending state
+	for (const auto& model : renderContext.scene->sceneModels)
+	{
+		loadJoints(model);
+
+		for (const auto& prim : model->getOpaquePrimitives())
+		{
+			ShaderProgram& program = capturePermutations.get(captureFeatures | getMaterialFeatures(prim->materialDesc));
+
+			// Few enough draws that switching in scene order is cheaper than bucketing them
+			if (&program != boundProgram)
+			{
+				program.use();
+				renderContext.buffers.bindBuffers(program);
+
+				program.setMat4("uCaptureViewProjection", projection * view);
+				program.setVec3("uProbePosition", position);
+
+				// Same units as the forward pass, every sampler type needs a unit of its own
+				program.setInt("uShadowAtlas", 5);
+				program.setInt("uPrefilteredMap", 8);
+				program.setInt("uBRDF", 9);
+
+				boundProgram = &program;
+			}
+
+			parseMaterialProperties(program, model->getTextures(), prim->materialDesc);
+
+			renderPrimitive(prim);
+		}
+	}
+}
+
+void ReflectionProbeRenderPass::uploadProbes()
+{
+	std::vector<ShaderReflectionProbe> shaderProbes;
+
+	for (size_t i = 0; i < probes.size(); i++)
+	{
+		if (!probes[i].ready) continue;
+
+		const ReflectionProbe& probe = probes[i].probe;
+
+		shaderProbes.push_back(
+			{
+				glm::vec4(probe.position, static_cast<float>(i)),
+				glm::vec4(probe.boxMin, probe.blendDistance),
+				glm::vec4(probe.boxMax, 0.0f)
+			}
+		);
+	}
+
+	// Smallest first, the shader gives earlier probes priority so the tightest fitting one wins
+	const auto volume = [](const ShaderReflectionProbe& probe)
+	{
+		const glm::vec3 size = glm::vec3(probe.boxMax) - glm::vec3(probe.boxMin);
+		return size.x * size.y * size.z;
+	};
+
+	std::sort(shaderProbes.begin(), shaderProbes.end(),
+		[&volume](const ShaderReflectionProbe& a, const ShaderReflectionProbe& b) { return volume(a) < volume(b); });
+
+	renderContext.buffers.bufferData("reflection_probes", sizeof(ShaderReflectionProbe) * shaderProbes.size(), shaderProbes.data());
+}
+
+void ReflectionProbeRenderPass::createTextures()
+{
+	glCreateTextures(GL_TEXTURE_CUBE_MAP_ARRAY, 1, &probeArray);
+	glTextureStorage3D(probeArray, PROBE_MIPS, GL_RGBA16F, PROBE_DIMENSIONS, PROBE_DIMENSIONS, 6 * MAX_REFLECTION_PROBES);
+
+	glTextureParameteri(probeArray, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(probeArray, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(probeArray, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(probeArray, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(probeArray, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	// Owned by the context so the forward pass can find it, the renderer cleans it up
+	renderContext.textures["reflectionProbes"] = probeArray;
+
+	// Views need names that have never been bound, glCreateTextures would make them 2D textures already
+	probeViews.resize(MAX_REFLECTION_PROBES);
+	glGenTextures(MAX_REFLECTION_PROBES, probeViews.data());
+
+	for (int i = 0; i < MAX_REFLECTION_PROBES; i++)
+	{
+		glTextureView(probeViews[i], GL_TEXTURE_CUBE_MAP, probeArray, GL_RGBA16F, 0, PROBE_MIPS, 6 * i, 6);
+	}
+
+	glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &captureCubemap);
+
+	const int captureMips = static_cast<int>(std::log2(PROBE_DIMENSIONS)) + 1;
+	glTextureStorage2D(captureCubemap, captureMips, GL_RGBA16F, PROBE_DIMENSIONS, PROBE_DIMENSIONS);
+
+	glTextureParameteri(captureCubemap, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(captureCubemap, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(captureCubemap, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(captureCubemap, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(captureCubemap, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	glCreateRenderbuffers(1, &captureDepth);
+	glNamedRenderbufferStorage(captureDepth, GL_DEPTH_COMPONENT32F, PROBE_DIMENSIONS, PROBE_DIMENSIONS);
+
+	glCreateFramebuffers(1, &framebuffer);
+	glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureDepth);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "renderPass.h"
+#include "cubemapPrefilter.h"
+
+// The scene's reflection probes, prefiltered into one cubemap array for the forward pass to blend between.
+// Probes are updated one at a time in small steps (a face capture or a prefilter mip), as many per frame
+// as fit the GPU budget, so moving a probe or changing the lighting never costs a whole recapture in one frame
+class ReflectionProbeRenderPass : public RenderPass
+{
+public:
+	ReflectionProbeRenderPass(RenderContext& renderContext);
+	~ReflectionProbeRenderPass();
+
+	ReflectionProbeRenderPass(const ReflectionProbeRenderPass&) = delete;
+	ReflectionProbeRenderPass& operator=(const ReflectionProbeRenderPass&) = delete;
+
+public:
+	// Picks up scene and lighting changes, advances the updates and uploads the ready probes
+	void frame() override;
+	void refresh() override;
+
+	// Recaptures every probe, over as many frames as it takes
+	void invalidate();
+
+	float getBudgetMilliseconds() const { return budgetMilliseconds; }
+	void setBudgetMilliseconds(float budgetMilliseconds) { this->budgetMilliseconds = budgetMilliseconds; }
+
+	int getNumProbes() const { return static_cast<int>(probes.size()); }
+	int getNumReadyProbes() const;
+
+	// Update steps taken last frame, their cost is the "Update" GPU profiler scope
+	int getStepsPerFrame() const { return stepsPerFrame; }
+
+private:
+	struct ProbeState
+	{
+		ReflectionProbe probe; // As captured, or being captured
+		bool ready; // Has a full capture, the forward pass can use it
+		bool dirty;
+	};
+
+	// Matches ReflectionProbe in reflection_probes.glsl
+	struct ShaderReflectionProbe
+	{
+		glm::vec4 position; // X Y Z + layer
+		glm::vec4 boxMin; // X Y Z + blend distance
+		glm::vec4 boxMax; // X Y Z + padding
+	};
+
+	void syncProbes();
+
+	// Lights, environment and the flags that change how the scene is lit
+	size_t getLightingSignature() const;
+
+	// Next probe to work on: any that has never been captured first, then dirty ones in turn
+	int pickProbe() const;
+
+	// Steps 0 - 5 capture a face, then one per prefiltered mip. True when the probe is finished
+	bool advanceProbe();
+
+	// The environment into every face of the capture, what the geometry is drawn over
+	void fillSky();
+
+	void captureFace(int face);
+
+	void uploadProbes();
+
+	void createTextures();
+
+private:
+	ShaderPermutationCache capturePermutations;
+	ShaderProgram skyShader;
+
+	CubemapPrefilter prefilter;
+
+	std::vector<ProbeState> probes;
+	size_t lightingSignature;
+
+	int updatingProbe; // -1 when idle
+	int probeStep;
+	int lastProbe; // Last one finished, dirty probes are picked round robin from here
+
+	float budgetMilliseconds;
+	float smoothedStepMilliseconds;
+	int stepsPerFrame;
+
+	std::string updatePath; // Of the update's GPU profiler scope, for its time
+
+	GLuint framebuffer;
+	GLuint captureDepth;
+	GLuint captureCubemap; // Full mip chain, the prefilter's source
+
+	GLuint probeArray; // Cubemap array, one cube per probe slot. Owned by the context as "reflectionProbes"
+	std::vector<GLuint> probeViews; // Cube views of each slot, for the prefilter to write
+};
\ No newline at end of file
@@ -33,20 +33,19 @@ void ShaderBufferManager::bindBuffers(ShaderProgram& program) const
 		glBindBuffer(buffer.target, buffer.id);
 		glBindBufferBase(buffer.target, bindingIndex, buffer.id);
 
+		// Not every program uses every block (e.g. shadow passes don't need lights), so skip the missing ones
 		GLuint blockIndex = 0;
 		if (buffer.target == GL_UNIFORM_BUFFER)
 		{
 			blockIndex = glGetUniformBlockIndex(program.getProgramId(), buffer.blockName.c_str());
-			if (blockIndex == GL_INVALID_INDEX) throw std::runtime_error("Invalid block name!");
-
-			glUniformBlockBinding(program.getProgramId(), blockIndex, bindingIndex);
+			if (blockIndex != GL_INVALID_INDEX)
+				glUniformBlockBinding(program.getProgramId(), blockIndex, bindingIndex);
 		}
 		else
 		{
 			blockIndex = glGetProgramResourceIndex(program.getProgramId(), GL_SHADER_STORAGE_BLOCK, buffer.blockName.c_str());
-			if (blockIndex == GL_INVALID_INDEX) throw std::runtime_error("Invalid block name!");
-
-			glShaderStorageBlockBinding(program.getProgramId(), blockIndex, bindingIndex);
+			if (blockIndex != GL_INVALID_INDEX)
+				glShaderStorageBlockBinding(program.getProgramId(), blockIndex, bindingIndex);
 		}
 
 		bindingIndex++;
@@ -124,6 +123,17 @@ void RenderPass::loadJoints(const std::shared_ptr<RenderableModel>& model)
 	}
 
 	renderContext.buffers.bufferData("joints", sizeof(glm::mat4) * jointMatrices.size(), jointMatrices.data());
+
+	// Last frame's joints are only read for velocity
+	if (!renderContext.flags[TAA_ENABLED]) return;
+
+	// First frame for this model, no motion
+	const auto previous = renderContext.previousJointMatrices.find(model.get());
+	const auto& previousJointMatrices = previous != renderContext.previousJointMatrices.end() ? previous->second : jointMatrices;
+
+	renderContext.buffers.bufferData("previous_joints", sizeof(glm::mat4) * previousJointMatrices.size(), previousJointMatrices.data());
+
+	renderContext.jointMatrices[model.get()] = std::move(jointMatrices);
 }
 
 void RenderPass::renderPrimitive(const std::shared_ptr<MeshPrimitive>& prim)
@@ -132,11 +142,23 @@ void RenderPass::renderPrimitive(const std::shared_ptr<MeshPrimitive>& prim)
 	{
 		glm::mat4 model;
 		glm::mat3x4 normalMatrix;
+		glm::mat4 previousModel;
 	} objectUniforms;
 
 	objectUniforms.model = prim->transform->getWorldTransform();
 	objectUniforms.normalMatrix = glm::transpose(glm::inverse(glm::mat3(objectUniforms.model)));
 
+	objectUniforms.previousModel = objectUniforms.model;
+
+	// Likewise the previous transform, only velocity needs it
+	if (renderContext.flags[TAA_ENABLED])
+	{
+		const auto previous = renderContext.previousModelMatrices.find(prim->transform.get());
+		if (previous != renderContext.previousModelMatrices.end()) objectUniforms.previousModel = previous->second;
+
+		renderContext.modelMatrices[prim->transform.get()] = objectUniforms.model;
+	}
+
 	renderContext.buffers.bufferData("object", sizeof(ObjectUniforms), &objectUniforms);
 
 	glBindVertexArray(prim->vertexArray);
@@ -148,9 +170,77 @@ void RenderPass::renderPrimitive(const std::shared_ptr<MeshPrimitive>& prim)
 	glBindVertexArray(0);
 }
 
-void RenderPass::parseMaterialProperties(const std::vector<GLuint>& textures, const tinygltf::Material& materialDesc)
+ShaderFeatures RenderPass::getFrameFeatures() const
+{
+	ShaderFeatures features = 0;
+
+	if (renderContext.flags[SHADOWS_ENABLED]) features |= 1u << FEATURE_SHADOWS;
+	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED]) features |= 1u << FEATURE_ENVIRONMENT_MAP;
+	if (renderContext.flags[TAA_ENABLED]) features |= 1u << FEATURE_TAA;
+
+	// Probes are part of the image based lighting
+	if (renderContext.flags[ENVIRONMENT_MAP_ENABLED] && renderContext.flags[REFLECTION_PROBES_ENABLED])
+		features |= 1u << FEATURE_REFLECTION_PROBES;
+
+	return features;
+}
+
+ShaderFeatures RenderPass::getMaterialFeatures(const tinygltf::Material& materialDesc) const
+{
+	const tinygltf::PbrMetallicRoughness& pbr = materialDesc.pbrMetallicRoughness;
+
+	ShaderFeatures features = 0;
+
+	if (pbr.baseColorTexture.index >= 0) features |= 1u << FEATURE_BASE_COLOUR_TEXTURE;
+	if (pbr.metallicRoughnessTexture.index >= 0) features |= 1u << FEATURE_METALLIC_ROUGHNESS_TEXTURE;
+
+	if (materialDesc.normalTexture.index >= 0 && renderContext.flags[NORMALS_ENABLED])
+		features |= 1u << FEATURE_NORMAL_TEXTURE;
+
+	if (materialDesc.occlusionTexture.index >= 0 && renderContext.flags[OCCLUSION_ENABLED])
+		features |= 1u << FEATURE_OCCLUSION_TEXTURE;
+
+	return features;
+}
+
+void RenderPass::parseMaterialProperties(ShaderProgram& shader, const std::vector<GLuint>& textures, const tinygltf::Material& materialDesc)
 {
+	const tinygltf::PbrMetallicRoughness& pbr = materialDesc.pbrMetallicRoughness;
+	const ShaderFeatures features = getMaterialFeatures(materialDesc);
 
+	shader.setVec4("uBaseColour.factor", glm::vec4(pbr.baseColorFactor[0], pbr.baseColorFactor[1], pbr.baseColorFactor[2], pbr.baseColorFactor[3]));
+	if (features & (1u << FEATURE_BASE_COLOUR_TEXTURE))
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, textures[pbr.baseColorTexture.index]);
+		shader.setInt("uBaseColour.textureMap", 0);
+	}
+
+	shader.setVec4("uMetallicRoughness.factor", glm::vec4(0.0, pbr.roughnessFactor, pbr.metallicFactor, 0.0));
+	if (features & (1u << FEATURE_METALLIC_ROUGHNESS_TEXTURE))
+	{
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, textures[pbr.metallicRoughnessTexture.index]);
+		shader.setInt("uMetallicRoughness.textureMap", 1);
+	}
+
+	if (features & (1u << FEATURE_NORMAL_TEXTURE))
+	{
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, textures[materialDesc.normalTexture.index]);
+		shader.setInt("uNormalMap.textureMap", 2);
+
+		shader.setVec4("uNormalMap.factor", glm::vec4(materialDesc.normalTexture.scale, 0.0, 0.0, 0.0));
+	}
+
+	if (features & (1u << FEATURE_OCCLUSION_TEXTURE))
+	{
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, textures[materialDesc.occlusionTexture.index]);
+		shader.setInt("uOcclusionMap.textureMap", 3);
+
+		shader.setVec4("uOcclusionMap.factor", glm::vec4(materialDesc.occlusionTexture.strength, 0.0, 0.0, 0.0));
+	}
 }
 
 
@@ -1,8 +1,14 @@
 #pragma once
 
 #include "camera.h"
+#include "cpuProfiler.h"
+#include "driverStats.h"
+#include "gpuProfiler.h"
 #include "scene.h"
 #include "shaderProgram.h"
+#include "shaderPermutationCache.h"
+#include "sphericalHarmonics.h"
+#include "sunExtraction.h"
 
 #include <stack>
 
@@ -16,9 +22,49 @@ enum RenderFlags : uint32_t {
 	EMULATE_SUN_ENABLED,
 	DEFERRED_PASS_ENABLED,
 	HDR_PASS_ENABLED,
+	BLOOM_ENABLED,
+	TAA_ENABLED,
+	SSAO_ENABLED,
+	REFLECTION_PROBES_ENABLED,
+	OVERDRAW_VIEW_ENABLED,
 	NUM_FLAGS
 };
 
+// Compile time switches of the forward shading (forward pass + probe captures), see ShaderPermutationCache.
+// Bit i is #defined as FORWARD_FEATURE_NAMES[i]
+enum ForwardFeature : uint32_t {
+	FEATURE_SHADOWS = 0,
+	FEATURE_ENVIRONMENT_MAP,
+	FEATURE_REFLECTION_PROBES,
+	FEATURE_TAA,
+	FEATURE_PROBE_CAPTURE,
+	FEATURE_BASE_COLOUR_TEXTURE,
+	FEATURE_METALLIC_ROUGHNESS_TEXTURE,
+	FEATURE_NORMAL_TEXTURE,
+	FEATURE_OCCLUSION_TEXTURE,
+	NUM_FORWARD_FEATURES
+};
+
+inline const std::vector<std::string> FORWARD_FEATURE_NAMES = {
+	"SHADOWS_ENABLED",
+	"ENVIRONMENT_MAP_ENABLED",
+	"REFLECTION_PROBES_ENABLED",
+	"TAA_ENABLED",
+	"PROBE_CAPTURE",
+	"BASE_COLOUR_TEXTURE",
+	"METALLIC_ROUGHNESS_TEXTURE",
+	"NORMAL_TEXTURE",
+	"OCCLUSION_TEXTURE"
+};
+
+// How point light shadows are projected, fewer views = fewer passes and less memory per light
+enum PointShadowMode : uint32_t {
+	POINT_SHADOW_CUBEMAP = 0,		// 6 views, 3x2 faces per atlas tile
+	POINT_SHADOW_TETRAHEDRAL,		// 4 views, 2x2 faces per atlas tile
+	POINT_SHADOW_DUAL_PARABOLOID,	// 2 views, 2x1 faces per atlas tile
+	NUM_POINT_SHADOW_MODES
+};
+
 class ShaderBufferManager
 {
 private:
@@ -81,10 +127,27 @@ private:
 struct RenderContext
 {
 	std::array<bool, RenderFlags::NUM_FLAGS> flags;
-	glm::ivec2 dimensions;
-	glm::mat4 projectionMatrix;
+	PointShadowMode pointShadowMode;
+	glm::ivec2 dimensions; // Internal render resolution
+	glm::ivec2 outputDimensions; // Window size, dimensions is scaled down from this
+	glm::mat4 projectionMatrix; // Unjittered
+	glm::mat4 viewMatrix;
+	glm::mat4 previousViewProjectionMatrix; // Last frame's, unjittered, for motion vectors
+	glm::vec2 jitter; // Sub-pixel projection offset this frame in render pixels, zero without TAA
 	float nearPlane, farPlane;
 
+	// What the post passes (bloom, exposure, tonemap) read: the HDR target, or the TAA resolve
+	GLuint sceneColour;
+	glm::ivec2 sceneColourDimensions;
+
+	// This frame's and last frame's transforms, for motion vectors. Swapped every frame so stale entries only last one
+	std::unordered_map<const TransformNode*, glm::mat4> modelMatrices, previousModelMatrices;
+	std::unordered_map<const RenderableModel*, std::vector<glm::mat4>> jointMatrices, previousJointMatrices;
+
+	// Diffuse environment lighting and the sun found in it, set by the environment pass
+	SphericalHarmonics irradianceSH;
+	SunEstimate environmentSun;
+
 	std::map<std::string, GLuint> textures;
 	ShaderBufferManager buffers;
 
@@ -92,15 +155,30 @@ struct RenderContext
 
 	FramebufferStack framebufferStack;
 
+	// Passes open their own scopes inside the one the renderer puts around their frame()
+	GPUProfiler gpuProfiler;
+
 	RenderContext() : 
 		flags(), 
+		pointShadowMode(POINT_SHADOW_CUBEMAP),
 		dimensions(), 
+		outputDimensions(),
 		projectionMatrix(), 
+		viewMatrix(),
+		previousViewProjectionMatrix(),
+		jitter(),
 		nearPlane(), farPlane(),
+		sceneColour(0),
+		sceneColourDimensions(),
+		modelMatrices(), previousModelMatrices(),
+		jointMatrices(), previousJointMatrices(),
+		irradianceSH(),
+		environmentSun(),
 		textures(), 
 		buffers(),
 		scene(nullptr),
-		framebufferStack()
+		framebufferStack(),
+		gpuProfiler()
 	{ }
 };
 
@@ -117,7 +195,14 @@ protected:
 	
 	void renderPrimitive(const std::shared_ptr<MeshPrimitive>& prim);
 
-	void parseMaterialProperties(const std::vector<GLuint>& textures, const tinygltf::Material& materialDesc);
+	// Forward features that follow the render flags, the same for every draw in a frame
+	ShaderFeatures getFrameFeatures() const;
+
+	// Textures the material has, less the ones the flags turn off
+	ShaderFeatures getMaterialFeatures(const tinygltf::Material& materialDesc) const;
+
+	// Factors, and textures on units 0 - 3. The program must be the permutation for these material features
+	void parseMaterialProperties(ShaderProgram& shader, const std::vector<GLuint>& textures, const tinygltf::Material& materialDesc);
 
 public:
 	virtual void frame() = 0;
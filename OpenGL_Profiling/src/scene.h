@@ -17,13 +17,27 @@ struct Light
 		DIRECTIONAL = 0,
 		POINT
 	} type;
+
+	bool operator==(const Light&) const = default;
+};
+
+// Local specular, captured from its position and parallax corrected against its box
+struct ReflectionProbe
+{
+	glm::vec3 position; // Should be inside the box
+	glm::vec3 boxMin;
+	glm::vec3 boxMax;
+	float blendDistance; // Fades in over this far inside the box, where it takes over from whatever is behind it
+
+	bool operator==(const ReflectionProbe&) const = default;
 };
 
 struct Scene
 {
 	std::vector<Light> sceneLights;
 	std::vector<std::shared_ptr<RenderableModel>> sceneModels;
+	std::vector<ReflectionProbe> reflectionProbes;
 	std::string environmentMap = "";
 
-	Scene() : sceneLights(), sceneModels(), environmentMap("") { }
+	Scene() : sceneLights(), sceneModels(), reflectionProbes(), environmentMap("") { }
 };
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "shaderPermutationCache.h"
+
+#include <spdlog/spdlog.h>
+
+#include <bit>
+
+ShaderPermutationCache::ShaderPermutationCache(const std::vector<std::pair<GLenum, std::filesystem::path>>& stages, const std::vector<std::string>& featureNames)
+	: stages(stages), featureNames(featureNames), programs()
+{ }
+
+ShaderProgram& ShaderPermutationCache::get(ShaderFeatures features)
+{
+	ShaderProgram& program = getProgram(features);
+	program.linkProgram();
+
+	return program;
+}
+
+ShaderProgram& ShaderPermutationCache::getReadyOrFallback(ShaderFeatures features)
+{
+	ShaderProgram& requested = getProgram(features);
+	if (requested.isReady()) return requested;
+
+	ShaderProgram* fallback = nullptr;
+	int fallbackFeatures = -1;
+
+	for (const auto& [candidateFeatures, program] : programs)
+	{
+		if ((candidateFeatures & ~features) != 0) continue;
+
+		const int numFeatures = std::popcount(candidateFeatures);
+		if (numFeatures > fallbackFeatures && program->isReady())
+		{
+			fallback = program.get();
+			fallbackFeatures = numFeatures;
+		}
+	}
+
+	return fallback ? *fallback : get(features);
+}
+
+void ShaderPermutationCache::prepare(ShaderFeatures features)
+{
+	getProgram(features);
+}
+
+ShaderProgram& ShaderPermutationCache::getProgram(ShaderFeatures features)
+{
+	auto& program = programs[features];
+	if (program) return *program;
+
+	spdlog::debug("Compiling shader permutation {:#x} of {}", features, stages.back().second.filename().string());
+
+	program = std::make_unique<ShaderProgram>();
+
+	for (size_t i = 0; i < featureNames.size(); i++)
+	{
+		program->addDefine(featureNames[i], (features >> i) & 1u ? "1" : "0");
+	}
+
+	for (const auto& [stage, path] : stages)
+	{
+		program->addShader(stage, path);
+	}
+
+	return *program;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "shaderProgram.h"
+
+#include <memory>
+
+using ShaderFeatures = uint32_t;
+
+// Specialisations of one set of shader stages, compiled the first time each feature mask is asked for.
+// Bit i of the mask #defines featureNames[i] as 1, clear bits as 0, so shaders drop dead branches
+// and unused samplers with #if instead of branching on uniforms
+class ShaderPermutationCache
+{
+public:
+	ShaderPermutationCache(const std::vector<std::pair<GLenum, std::filesystem::path>>& stages, const std::vector<std::string>& featureNames);
+
+	ShaderPermutationCache(const ShaderPermutationCache&) = delete;
+	ShaderPermutationCache& operator=(const ShaderPermutationCache&) = delete;
+
+public:
+	// Waits for the permutation to finish compiling
+	ShaderProgram& get(ShaderFeatures features);
+
+	// The permutation if it's ready, otherwise (while it compiles) the ready one with the most of its features
+	// and none it lacks, so it renders plainer instead of stalling. Only waits when nothing fits yet
+	ShaderProgram& getReadyOrFallback(ShaderFeatures features);
+
+	// Starts compiling without waiting for it
+	void prepare(ShaderFeatures features);
+
+	size_t getNumPermutations() const { return programs.size(); }
+
+private:
+	ShaderProgram& getProgram(ShaderFeatures features);
+
+private:
+	const std::vector<std::pair<GLenum, std::filesystem::path>> stages;
+	const std::vector<std::string> featureNames;
+
+	std::unordered_map<ShaderFeatures, std::unique_ptr<ShaderProgram>> programs;
+};
\ No newline at end of file
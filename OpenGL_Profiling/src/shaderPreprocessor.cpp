@@ -0,0 +1,219 @@
+#include "shaderPreprocessor.h"
+#include "cpuProfiler.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <sstream>
+
+namespace
+{
+	struct CachedFile
+	{
+		std::filesystem::file_time_type modified;
+		std::shared_ptr<const std::vector<std::string>> lines;
+	};
+
+	std::mutex cacheMutex;
+	std::map<std::filesystem::path, CachedFile> fileCache;
+	std::map<std::filesystem::path, std::set<std::filesystem::path>> includers; // File -> files that directly include it
+
+	// The cached lines, reread when the file has changed since
+	std::shared_ptr<const std::vector<std::string>> readLines(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		const auto modified = std::filesystem::last_write_time(path, error);
+		if (error) return nullptr;
+
+		{
+			std::lock_guard lock(cacheMutex);
+
+			const auto cached = fileCache.find(path);
+			if (cached != fileCache.end() && cached->second.modified == modified) return cached->second.lines;
+		}
+
+		std::ifstream file(path);
+		if (!file.is_open()) return nullptr;
+
+		auto lines = std::make_shared<std::vector<std::string>>();
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			lines->push_back(std::move(line));
+		}
+
+		spdlog::trace("Loaded shader file: {}", path.string());
+
+		std::lock_guard lock(cacheMutex);
+		fileCache[path] = { modified, lines };
+
+		return lines;
+	}
+
+	// The quoted path of an #include line
+	std::optional<std::string> parseInclude(const std::string& line)
+	{
+		const size_t directive = line.find_first_not_of(" \t");
+		if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0) return std::nullopt;
+
+		const size_t open = line.find('"', directive);
+		const size_t close = line.find('"', open + 1);
+		if (open == std::string::npos || close == std::string::npos) return std::nullopt;
+
+		return line.substr(open + 1, close - open - 1);
+	}
+
+	struct Expansion
+	{
+		const std::string& defines;
+		PreprocessedShader& result;
+		std::stringstream source;
+		std::vector<std::pair<std::filesystem::path, std::filesystem::path>> edges; // Includer, included
+	};
+
+	bool expand(const std::filesystem::path& path, Expansion& expansion)
+	{
+		const auto lines = readLines(path);
+		if (!lines)
+		{
+			spdlog::error("Failed to load shader file: {}", path.string());
+			return false;
+		}
+
+		const int fileIndex = static_cast<int>(expansion.result.files.size());
+		expansion.result.files.push_back(path);
+
+		// Stage files start at line 1 on their own, includes need telling
+		if (fileIndex > 0) expansion.source << "#line 1 " << fileIndex << "\n";
+
+		for (size_t i = 0; i < lines->size(); i++)
+		{
+			const std::string& line = (*lines)[i];
+			const int nextLine = static_cast<int>(i) + 2;
+
+			if (const auto include = parseInclude(line))
+			{
+				const std::filesystem::path includePath = normalizeShaderPath(path.parent_path() / *include);
+				expansion.edges.emplace_back(path, includePath);
+
+				const auto& files = expansion.result.files;
+				if (std::find(files.begin(), files.end(), includePath) != files.end())
+				{
+					// Already in this stage, keep the line count
+					expansion.source << "\n";
+					continue;
+				}
+
+				if (!expand(includePath, expansion))
+				{
+					spdlog::error("Invalid #include path in: {}", path.string());
+					return false;
+				}
+
+				expansion.source << "#line " << nextLine << " " << fileIndex << "\n";
+			}
+			else if (fileIndex == 0 && line.starts_with("#version"))
+			{
+				// #version has to stay the first statement
+				expansion.source << line << "\n" << expansion.defines;
+				if (!expansion.defines.empty()) expansion.source << "#line " << nextLine << " 0\n";
+			}
+			else
+			{
+				expansion.source << line << "\n";
+			}
+		}
+
+		return true;
+	}
+}
+
+std::optional<PreprocessedShader> preprocessShader(const std::filesystem::path& path, const std::string& defines)
+{
+	PROFILE_SCOPE("preprocessShader");
+
+	PreprocessedShader result;
+	Expansion expansion{ defines, result };
+
+	if (!expand(normalizeShaderPath(path), expansion)) return std::nullopt;
+
+	result.source = expansion.source.str();
+
+	std::lock_guard lock(cacheMutex);
+	for (const auto& [includer, included] : expansion.edges)
+	{
+		includers[included].insert(includer);
+	}
+
+	return result;
+}
+
+std::vector<std::filesystem::path> getShaderDependents(const std::filesystem::path& path)
+{
+	std::lock_guard lock(cacheMutex);
+
+	std::vector<std::filesystem::path> dependents;
+	std::vector<std::filesystem::path> open = { normalizeShaderPath(path) };
+
+	while (!open.empty())
+	{
+		const std::filesystem::path file = open.back();
+		open.pop_back();
+
+		const auto found = includers.find(file);
+		if (found == includers.end()) continue;
+
+		for (const auto& includer : found->second)
+		{
+			if (std::find(dependents.begin(), dependents.end(), includer) != dependents.end()) continue;
+
+			dependents.push_back(includer);
+			open.push_back(includer);
+		}
+	}
+
+	return dependents;
+}
+
+std::filesystem::path normalizeShaderPath(const std::filesystem::path& path)
+{
+	return path.lexically_normal();
+}
+
+std::string PreprocessedShader::mapLog(const std::string& log) const
+{
+	// Mesa "0:12(5):", NVIDIA "0(12) :", AMD / Intel "ERROR: 0:12:"
+	static const std::regex location(R"((\d+)([:(])(\d+))");
+
+	std::stringstream mapped;
+	std::stringstream lines(log);
+
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		std::smatch match;
+		if (std::regex_search(line, match, location))
+		{
+			const size_t fileIndex = std::stoul(match[1].str());
+			if (fileIndex < files.size())
+			{
+				// NVIDIA's form leaves a ")" behind
+				std::string suffix = match.suffix().str();
+				if (match[2].str() == "(" && suffix.starts_with(")")) suffix.erase(0, 1);
+
+				line = match.prefix().str() + files[fileIndex].string() + ":" + match[3].str() + suffix;
+			}
+		}
+
+		mapped << line << "\n";
+	}
+
+	return mapped.str();
+}
\ No newline at end of file
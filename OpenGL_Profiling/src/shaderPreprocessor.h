@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A shader stage ready for glShaderSource, and what went into it
+struct PreprocessedShader
+{
+	std::string source;
+
+	// Every file spliced in, the stage itself first. A file's index here is the source string
+	// number of the #line directives, compile logs use it in place of a file name
+	std::vector<std::filesystem::path> files;
+
+	// Rewrites the "index:line" / "index(line)" locations in a compile log into file names
+	std::string mapLog(const std::string& log) const;
+};
+
+// The shaders' #include handling. Includes are relative to the including file, nest to any depth
+// and are implicitly guarded, each file goes into a stage at most once however many files include it.
+// File contents are cached by path and modification time, so a shared include is only read from
+// disk once, and the include graph is recorded as files are preprocessed.
+// All thread safe, preprocessing runs on worker threads
+
+// defines go straight after the #version line. Nothing if the stage or one of its includes can't be read
+std::optional<PreprocessedShader> preprocessShader(const std::filesystem::path& path, const std::string& defines);
+
+// Every file that includes this one, directly or not, as far as preprocessing has seen
+std::vector<std::filesystem::path> getShaderDependents(const std::filesystem::path& path);
+
+// How paths are keyed in the cache and graph
+std::filesystem::path normalizeShaderPath(const std::filesystem::path& path);
\ No newline at end of file
@@ -1,15 +1,30 @@
 #include "shaderProgram.h"
+#include "programBinaryCache.h"
+#include "shaderPreprocessor.h"
 
 #include <spdlog/spdlog.h>
 
-#include <fstream>
-#include <sstream>
-#include <iostream>
+#include <algorithm>
+#include <set>
 #include <string>
 
+// GL_KHR_parallel_shader_compile, not every loader generates it
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Set from main once the extension is known to be there
+bool ShaderProgram::parallelCompile = false;
+
+std::vector<ShaderProgram*> ShaderProgram::allPrograms;
+std::vector<ShaderProgram*> ShaderProgram::pendingPrograms;
+size_t ShaderProgram::numCompiling = 0;
+
 ShaderProgram::ShaderProgram(const std::filesystem::path vertexShader, const std::filesystem::path fragmentShader)
-	: isLinked(false)
+	: isLinked(false), isCompiling(false), isFailed(false), sourceHash(0), isReplacement(false)
 {
+    allPrograms.push_back(this);
+
 	addShader(GL_VERTEX_SHADER, vertexShader);
     addShader(GL_FRAGMENT_SHADER, fragmentShader);
 
@@ -17,21 +32,36 @@ ShaderProgram::ShaderProgram(const std::filesystem::path vertexShader, const std
 }
 
 ShaderProgram::ShaderProgram()
-    : isLinked(false)
+    : isLinked(false), isCompiling(false), isFailed(false), sourceHash(0), isReplacement(false)
 {
+    allPrograms.push_back(this);
+
     programId = glCreateProgram();
 }
 
 ShaderProgram::~ShaderProgram()
 {
-    for (const auto& shader : shaders)
+    std::erase(allPrograms, this);
+    std::erase(pendingPrograms, this);
+
+    if (isCompiling)
     {
-        glDeleteShader(shader.id);
+        numCompiling--;
+
+        for (const GLuint shaderId : compilingShaders)
+        {
+            glDeleteShader(shaderId);
+        }
     }
 
     glDeleteProgram(programId);
 }
 
+void ShaderProgram::addDefine(const std::string& name, const std::string& value)
+{
+    defines += "#define " + name + " " + value + "\n";
+}
+
 void ShaderProgram::addShader(GLenum stage, const std::filesystem::path shaderPath)
 {
     if (isLinked)
@@ -39,124 +69,289 @@ void ShaderProgram::addShader(GLenum stage, const std::filesystem::path shaderPa
         isLinked = false;
     }
 
-    GLuint shaderId = glCreateShader(stage);
+    isFailed = false;
+
+    // File reads and includes happen on a worker, the GL side waits for compile()
+    shaders.push_back({ stage, shaderPath, defines, std::async(std::launch::async, preprocessShader, shaderPath, defines).share() });
 
-    if (!compileShader(shaderId, shaderPath))
+    if (std::find(pendingPrograms.begin(), pendingPrograms.end(), this) == pendingPrograms.end())
     {
-        glDeleteShader(shaderId);
-        return;
+        pendingPrograms.push_back(this);
     }
-
-    shaders.push_back({ shaderId, shaderPath });
 }
 
-bool ShaderProgram::compileShader(GLuint shader, const std::filesystem::path shaderPath)
+bool ShaderProgram::checkShader(GLuint shader, const Shader& source) const
 {
-    spdlog::trace("Loading shader file: {}", shaderPath.filename().string());
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        GLsizei logSize;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
+
+        std::string infoLog;
+        infoLog.resize(logSize);
+        glGetShaderInfoLog(shader, logSize, NULL, infoLog.data());
+
+        spdlog::critical("Failed to compile shader: {} \n\n\n{}", source.path.string(), source.source.get()->mapLog(infoLog));
+        return false;
+    };
+
+    return static_cast<bool>(success);
+}
 
-    std::string shaderCode;
-    std::ifstream shaderFile;
+void ShaderProgram::compilePending()
+{
+    // compile() takes programs off the list
+    const std::vector<ShaderProgram*> programs = pendingPrograms;
 
-    try
+    for (ShaderProgram* program : programs)
     {
-        shaderFile.open(shaderPath);
-        std::stringstream shaderStream;
+        if (program->areSourcesReady()) program->compile();
+    }
+}
 
-        // Do some simple custom preprocessor stuff
-        // #include -> works exactly like in c++
+bool ShaderProgram::areSourcesReady() const
+{
+    for (const auto& shader : shaders)
+    {
+        if (shader.source.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+    }
 
-        std::string line;
-        while (std::getline(shaderFile, line))
-        {
-            if (line.starts_with("#include \""))
-            {
-                std::string includeFile =
-                    line.substr(line.find('"') + 1, line.find_last_of('"') - line.find('"') - 1);
+    return true;
+}
 
-                std::filesystem::path includePath = shaderPath.parent_path() / includeFile;
+void ShaderProgram::compile()
+{
+    if (isLinked || isCompiling || isFailed) return;
 
-                std::ifstream includeStream(includePath);
+    if (shaders.size() < 1) return;
 
-                if (includeStream.is_open())
-                {
-                    shaderStream << includeStream.rdbuf() << "\n";
-                }
-                else
-                {
-                    spdlog::error("Invalid #include path in: {}", shaderPath.filename().string());
-                }
+    std::erase(pendingPrograms, this);
 
-                includeStream.close();
-            }
-            else
-            {
-                shaderStream << line << "\n";
-            }
+    for (const auto& shader : shaders)
+    {
+        if (!shader.source.get())
+        {
+            isFailed = true;
+            return;
         }
+    }
 
-        shaderFile.close();
+    sourceHash = getSourceHash();
 
-        shaderCode = shaderStream.str();
+    if (loadProgramBinary(programId, sourceHash))
+    {
+        isLinked = true;
+        return;
     }
-    catch (std::ifstream::failure e)
+
+    // Nothing here waits on the driver, with parallel compile it all happens on its threads
+    for (const auto& shader : shaders)
     {
-        spdlog::error("Failed to load shader file: {}", shaderPath.filename().string());
-        spdlog::error(e.what());
-        return false;
+        const GLuint shaderId = glCreateShader(shader.stage);
+        compilingShaders.push_back(shaderId);
+
+        const char* pshaderCode = shader.source.get()->source.c_str();
+
+        glShaderSource(shaderId, 1, &pshaderCode, NULL);
+        glCompileShader(shaderId);
+
+        glAttachShader(programId, shaderId);
     }
 
-    const char* pshaderCode = shaderCode.c_str();
+    glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(programId);
 
-    glShaderSource(shader, 1, &pshaderCode, NULL);
+    isCompiling = true;
+    numCompiling++;
+}
 
-    glCompileShader(shader);
+void ShaderProgram::finishLink()
+{
+    isCompiling = false;
+    numCompiling--;
 
+    // Only worth asking for the individual stages when the link failed, they explain why
     int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    glGetProgramiv(programId, GL_LINK_STATUS, &success);
     if (!success)
     {
-        GLsizei logSize;
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
+        bool compiled = true;
+        for (size_t i = 0; i < compilingShaders.size(); i++)
+        {
+            compiled &= checkShader(compilingShaders[i], shaders[i]);
+        }
 
-        std::string infoLog;
-        infoLog.resize(logSize);
-        glGetShaderInfoLog(shader, logSize, NULL, infoLog.data());
+        if (compiled)
+        {
+            constexpr GLsizei logSize = 512;
+            std::string infoLog;
 
-        spdlog::critical("Failed to compile shader: {} \n\n\n{}", shaderPath.string(), infoLog);
-        return false;
+            infoLog.resize(logSize);
+
+            glGetProgramInfoLog(programId, logSize, NULL, infoLog.data());
+            spdlog::error("Failed to link shaders: \n\n\n{}", infoLog);
+        }
     };
 
-    return static_cast<bool>(success);
+    // The linked program keeps everything it needs, the stages can go straight away
+    for (const GLuint shaderId : compilingShaders)
+    {
+        glDetachShader(programId, shaderId);
+        glDeleteShader(shaderId);
+    }
+
+    compilingShaders.clear();
+
+    if (!success)
+    {
+        isFailed = true;
+        return;
+    }
+
+    saveProgramBinary(programId, sourceHash);
+
+    isLinked = true;
 }
 
-void ShaderProgram::linkProgram()
+void ShaderProgram::reloadChanged(const std::vector<std::filesystem::path>& changed)
 {
-    if (isLinked) return;
+    std::set<std::filesystem::path> affected;
 
-    if (shaders.size() < 1) return;
+    for (const auto& path : changed)
+    {
+        affected.insert(normalizeShaderPath(path));
+
+        for (const auto& dependent : getShaderDependents(path))
+        {
+            affected.insert(dependent);
+        }
+    }
+
+    for (ShaderProgram* program : std::vector<ShaderProgram*>(allPrograms))
+    {
+        if (program->isReplacement) continue;
+
+        for (const auto& shader : program->shaders)
+        {
+            if (affected.contains(normalizeShaderPath(shader.path)))
+            {
+                program->reload();
+                break;
+            }
+        }
+    }
+}
+
+void ShaderProgram::reloadAll()
+{
+    for (ShaderProgram* program : std::vector<ShaderProgram*>(allPrograms))
+    {
+        if (!program->isReplacement) program->reload();
+    }
+}
+
+void ShaderProgram::reload()
+{
+    // Never built, it will read the files as they are now anyway
+    if (!isLinked && !isFailed) return;
+
+    // Starting over replaces any reload still in progress
+    replacement = std::make_unique<ShaderProgram>();
+    replacement->isReplacement = true;
 
     for (const auto& shader : shaders)
     {
-        glAttachShader(programId, shader.id);
+        replacement->defines = shader.defines;
+        replacement->addShader(shader.stage, shader.path);
     }
+}
 
-    glLinkProgram(programId);
+void ShaderProgram::swapReloaded()
+{
+    // Taken first, swapping destroys the replacements
+    std::vector<ShaderProgram*> reloading;
+    for (ShaderProgram* program : allPrograms)
+    {
+        if (!program->isReplacement && program->replacement) reloading.push_back(program);
+    }
 
-    int success;
-    glGetProgramiv(programId, GL_LINK_STATUS, &success);
-    if (!success)
+    for (ShaderProgram* program : reloading)
     {
-        constexpr GLsizei logSize = 512;
-        std::string infoLog;
+        ShaderProgram& replacement = *program->replacement;
 
-        infoLog.resize(logSize);
+        if (replacement.isReady())
+        {
+            // The replacement deletes the old program along with itself
+            std::swap(program->programId, replacement.programId);
+            std::swap(program->shaders, replacement.shaders);
 
-        glGetProgramInfoLog(programId, logSize, NULL, infoLog.data());
-        spdlog::error("Failed to link shaders: \n\n\n{}", infoLog);
-        return;
-    };
+            program->isLinked = true;
+            program->isFailed = false;
 
-    isLinked = true;
+            spdlog::info("Reloaded shader program: {}", program->shaders.back().path.filename().string());
+        }
+        else if (replacement.isFailed)
+        {
+            spdlog::warn("Keeping the previous build of: {}", program->shaders.back().path.filename().string());
+        }
+        else
+        {
+            continue;
+        }
+
+        program->replacement.reset();
+    }
+}
+
+uint64_t ShaderProgram::getSourceHash() const
+{
+    uint64_t hash = getProgramBinaryKey();
+
+    for (const auto& shader : shaders)
+    {
+        hash = hashString(std::to_string(shader.stage), hash);
+        hash = hashString(shader.source.get()->source, hash);
+    }
+
+    return hash;
+}
+
+bool ShaderProgram::isReady()
+{
+    if (isLinked) return true;
+
+    if (!isCompiling)
+    {
+        // Still preprocessing, or not asked for before
+        if (!areSourcesReady()) return false;
+
+        compile();
+
+        if (!isCompiling) return isLinked;
+    }
+
+    // Without the extension there is no asking, finishing just waits
+    if (parallelCompile)
+    {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(programId, GL_COMPLETION_STATUS_KHR, &complete);
+        if (!complete) return false;
+    }
+
+    finishLink();
+
+    return isLinked;
+}
+
+void ShaderProgram::linkProgram()
+{
+    if (isLinked) return;
+
+    compile();
+
+    if (isCompiling) finishLink();
 }
 
 void ShaderProgram::use()
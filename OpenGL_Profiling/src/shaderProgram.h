@@ -5,9 +5,14 @@
 
 #include <glad/glad.h>
 
+#include "shaderPreprocessor.h"
+
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 
 class ShaderProgram
@@ -15,8 +20,10 @@ class ShaderProgram
 private:
 	struct Shader
 	{
-		const GLuint id;
+		const GLenum stage;
 		const std::filesystem::path path;
+		const std::string defines;
+		const std::shared_future<std::optional<PreprocessedShader>> source; // Nothing if a file couldn't be read
 	};
 
 public:
@@ -24,12 +31,44 @@ public:
 	ShaderProgram();
 	~ShaderProgram();
 
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+
 public:
+	// With GL_KHR_parallel_shader_compile the driver compiles on its own threads and isReady can ask without stalling
+	static void setParallelCompile(bool parallelCompile) { ShaderProgram::parallelCompile = parallelCompile; }
+
+	// Starts compiling every program whose sources have been preprocessed, once a frame
+	// (and straight after loading) so nothing waits for its first use to begin
+	static void compilePending();
+
+	// Programs the driver is still compiling
+	static size_t getNumCompiling() { return numCompiling; }
+
+	// Rebuilds every program that uses one of these files, directly or through includes. The old program
+	// stays in use until the new one has linked, and for good if it doesn't
+	static void reloadChanged(const std::vector<std::filesystem::path>& changed);
+	static void reloadAll();
+
+	// Swaps in the reloads that have finished linking, once a frame after compilePending
+	static void swapReloaded();
 
 	const GLuint getProgramId() const { return programId; }
 
+	// Goes in after the #version line of every stage added from here on, so must come before addShader
+	void addDefine(const std::string& name, const std::string& value = "1");
+
+	// Only starts reading and preprocessing the file on a worker thread, compiling waits for compile()
 	void addShader(GLenum stage, const std::filesystem::path shaderPath);
 	
+	// Kicks off compiling and linking without waiting for the result. Straight from the program binary
+	// cache when the same sources were linked before by the same driver
+	void compile();
+
+	// Never stalls with parallel compile, starts compiling if nothing has yet
+	bool isReady();
+
+	// Waits for compile() to finish, starting it if need be
 	void linkProgram();
 	
 	void use();
@@ -105,11 +144,38 @@ public:
 	}
 
 private:
-	bool compileShader(GLuint shader, const std::filesystem::path shaderPath);
+	bool checkShader(GLuint shader, const Shader& source) const;
+
+	bool areSourcesReady() const;
+
+	// Collects the result of compile(), stalls if the driver hasn't finished
+	void finishLink();
+
+	// Starts building a replacement from the same files, if this has been built at all
+	void reload();
+
+	// Of the preprocessed sources, what the binary cache is keyed by
+	uint64_t getSourceHash() const;
 
 private:
+	static bool parallelCompile;
+	static std::vector<ShaderProgram*> allPrograms; // GL thread only, as are the rest
+	static std::vector<ShaderProgram*> pendingPrograms; // Sources added but not compiled yet
+	static size_t numCompiling;
+
 	bool isLinked;
+	bool isCompiling;
+	bool isFailed; // Until a shader is added again, rather than retrying every use
+
 	GLuint programId;
 
 	std::vector<Shader> shaders;
+	std::vector<GLuint> compilingShaders; // Parallel to shaders while compiling
+
+	uint64_t sourceHash;
+
+	std::unique_ptr<ShaderProgram> replacement; // Reload in progress
+	bool isReplacement;
+
+	std::string defines; // "#define NAME VALUE" lines
 };
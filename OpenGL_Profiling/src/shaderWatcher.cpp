@@ -0,0 +1,151 @@
+#include "shaderWatcher.h"
+#include "shaderPreprocessor.h"
+
+#include <spdlog/spdlog.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// How long the thread sleeps between looking, also how long stopping can take
+constexpr int WATCH_INTERVAL_MILLISECONDS = 100;
+
+ShaderWatcher::ShaderWatcher(const std::filesystem::path& directory)
+	: directory(directory), running(true)
+{
+#ifdef __linux__
+	inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify < 0)
+	{
+		spdlog::warn("Shader hot reload disabled, inotify unavailable");
+		running = false;
+		return;
+	}
+
+	addWatches(directory);
+#else
+	pollModified(false);
+#endif
+
+	thread = std::thread(&ShaderWatcher::watch, this);
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	running = false;
+
+	if (thread.joinable()) thread.join();
+
+#ifdef __linux__
+	if (inotify >= 0) close(inotify);
+#endif
+}
+
+std::vector<std::filesystem::path> ShaderWatcher::takeChanges()
+{
+	std::lock_guard lock(changesMutex);
+
+	std::vector<std::filesystem::path> taken(changes.begin(), changes.end());
+	changes.clear();
+
+	return taken;
+}
+
+void ShaderWatcher::addChange(const std::filesystem::path& path)
+{
+	if (path.extension() != ".glsl") return;
+
+	spdlog::debug("Shader changed: {}", path.string());
+
+	std::lock_guard lock(changesMutex);
+	changes.insert(normalizeShaderPath(path));
+}
+
+#ifdef __linux__
+
+void ShaderWatcher::addWatches(const std::filesystem::path& directory)
+{
+	// Editors that save by renaming a temporary over the file show up as IN_MOVED_TO
+	const int watch = inotify_add_watch(inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (watch < 0)
+	{
+		spdlog::warn("Failed to watch shader directory: {}", directory.string());
+		return;
+	}
+
+	watches[watch] = directory;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (entry.is_directory()) addWatches(entry.path());
+	}
+}
+
+void ShaderWatcher::watch()
+{
+	alignas(inotify_event) char buffer[4096];
+
+	while (running)
+	{
+		pollfd descriptor = { inotify, POLLIN, 0 };
+		if (poll(&descriptor, 1, WATCH_INTERVAL_MILLISECONDS) <= 0) continue;
+
+		ssize_t length;
+		while ((length = read(inotify, buffer, sizeof(buffer))) > 0)
+		{
+			for (ssize_t offset = 0; offset < length; )
+			{
+				const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				const auto watch = watches.find(event->wd);
+				if (watch == watches.end() || event->len == 0) continue;
+
+				const std::filesystem::path path = watch->second / event->name;
+
+				if (event->mask & IN_ISDIR)
+				{
+					if (event->mask & IN_CREATE) addWatches(path);
+				}
+				else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				{
+					addChange(path);
+				}
+			}
+		}
+	}
+}
+
+#else
+
+void ShaderWatcher::pollModified(bool reportChanges)
+{
+	std::error_code error;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+	{
+		if (!entry.is_regular_file()) continue;
+
+		const auto time = entry.last_write_time(error);
+		if (error) continue;
+
+		auto& known = modified[entry.path()];
+		if (known != time && reportChanges) addChange(entry.path());
+
+		known = time;
+	}
+}
+
+void ShaderWatcher::watch()
+{
+	while (running)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(WATCH_INTERVAL_MILLISECONDS));
+
+		pollModified(true);
+	}
+}
+
+#endif
\ No newline at end of file
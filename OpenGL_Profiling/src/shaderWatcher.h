@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+// Watches a directory tree of shader sources for changes on a thread of its own.
+// inotify on Linux, elsewhere modification times are polled
+class ShaderWatcher
+{
+public:
+	ShaderWatcher(const std::filesystem::path& directory);
+	~ShaderWatcher();
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+public:
+	// Files written since the last call, as normalizeShaderPath keys them
+	std::vector<std::filesystem::path> takeChanges();
+
+private:
+	void watch();
+
+	void addChange(const std::filesystem::path& path);
+
+#ifdef __linux__
+	void addWatches(const std::filesystem::path& directory);
+#else
+	void pollModified(bool reportChanges);
+#endif
+
+private:
+	const std::filesystem::path directory;
+
+	std::atomic<bool> running;
+	std::thread thread;
+
+	std::mutex changesMutex;
+	std::set<std::filesystem::path> changes;
+
+#ifdef __linux__
+	int inotify;
+	std::map<int, std::filesystem::path> watches; // Watch descriptor -> directory
+#else
+	std::map<std::filesystem::path, std::filesystem::file_time_type> modified;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "shadowAtlas.h"
+
+#include <array>
+
+static const std::array<glm::ivec2, 4> childOffsets = {
+	glm::ivec2(0, 0), glm::ivec2(1, 0), glm::ivec2(0, 1), glm::ivec2(1, 1)
+};
+
+ShadowAtlas::ShadowAtlas(int dimensions, int minTileDimensions)
+	: dimensions(), minTileDimensions(minTileDimensions), levels()
+{
+	reset(dimensions);
+}
+
+void ShadowAtlas::reset(int dimensions)
+{
+	this->dimensions = dimensions;
+
+	levels.clear();
+	for (int size = dimensions, level = 0; size >= minTileDimensions; size /= 2, level++)
+	{
+		levels.emplace_back(static_cast<size_t>(1) << (2 * level), NodeState::FREE);
+	}
+}
+
+std::optional<ShadowAtlas::Tile> ShadowAtlas::allocate(int level)
+{
+	if (level < 0 || level >= getNumLevels()) return std::nullopt;
+
+	Tile tile = { };
+	if (allocateNode(0, glm::ivec2(0), level, tile)) return tile;
+
+	return std::nullopt;
+}
+
+bool ShadowAtlas::allocateNode(int level, glm::ivec2 node, int targetLevel, Tile& tile)
+{
+	NodeState& state = getNode(level, node);
+
+	if (state == NodeState::USED) return false;
+
+	if (level == targetLevel)
+	{
+		if (state != NodeState::FREE) return false;
+
+		state = NodeState::USED;
+		tile = { level, node };
+		return true;
+	}
+
+	if (state == NodeState::FREE)
+	{
+		// Nothing below here is in use, so the first child will always fit
+		state = NodeState::SPLIT;
+		return allocateNode(level + 1, node * 2, targetLevel, tile);
+	}
+
+	// Fill partially used nodes before breaking up free ones, keeps the big tiles available
+	for (const NodeState pass : { NodeState::SPLIT, NodeState::FREE })
+	{
+		for (const auto& offset : childOffsets)
+		{
+			const glm::ivec2 child = node * 2 + offset;
+
+			if (getNode(level + 1, child) == pass && allocateNode(level + 1, child, targetLevel, tile)) return true;
+		}
+	}
+
+	return false;
+}
+
+void ShadowAtlas::free(const Tile& tile)
+{
+	getNode(tile.level, tile.node) = NodeState::FREE;
+
+	// Merge back up while all four siblings are free
+	glm::ivec2 node = tile.node;
+	for (int level = tile.level; level > 0; level--)
+	{
+		const glm::ivec2 parent = node / 2;
+
+		for (const auto& offset : childOffsets)
+		{
+			if (getNode(level, parent * 2 + offset) != NodeState::FREE) return;
+		}
+
+		getNode(level - 1, parent) = NodeState::FREE;
+		node = parent;
+	}
+}
+
+glm::ivec4 ShadowAtlas::getTileRect(const Tile& tile) const
+{
+	const int size = getTileDimensions(tile.level);
+
+	return glm::ivec4(tile.node * size, size, size);
+}
+
+float ShadowAtlas::getUsage() const
+{
+	float usage = 0.0f;
+
+	for (size_t level = 0; level < levels.size(); level++)
+	{
+		const float tileArea = 1.0f / static_cast<float>(levels[level].size());
+
+		for (const NodeState state : levels[level])
+		{
+			if (state == NodeState::USED) usage += tileArea;
+		}
+	}
+
+	return usage;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Quadtree allocator for square tiles of a single shadow atlas, CPU side only.
+// Level 0 is the whole atlas, each level down halves the tile size
+class ShadowAtlas
+{
+public:
+	struct Tile
+	{
+		int level;
+		glm::ivec2 node; // Position in the level's grid
+
+		bool operator==(const Tile&) const = default;
+	};
+
+public:
+	ShadowAtlas(int dimensions, int minTileDimensions);
+
+	void reset(int dimensions);
+
+	// Allocates a tile at exactly this level, if there is room
+	std::optional<Tile> allocate(int level);
+	void free(const Tile& tile);
+
+	int getDimensions() const { return dimensions; }
+	int getNumLevels() const { return static_cast<int>(levels.size()); }
+
+	int getTileDimensions(int level) const { return dimensions >> level; }
+
+	// X Y offset + size, in texels
+	glm::ivec4 getTileRect(const Tile& tile) const;
+
+	// Fraction of the atlas handed out
+	float getUsage() const;
+
+private:
+	enum class NodeState : uint8_t
+	{
+		FREE,	// Unused, and so are all its children
+		SPLIT,	// Some children are in use
+		USED	// Handed out as a tile
+	};
+
+	int dimensions;
+	int minTileDimensions;
+
+	std::vector<std::vector<NodeState>> levels; // levels[level][y * (1 << level) + x]
+
+	NodeState& getNode(int level, glm::ivec2 node) { return levels[level][node.y * (1 << level) + node.x]; }
+
+	bool allocateNode(int level, glm::ivec2 node, int targetLevel, Tile& tile);
+};
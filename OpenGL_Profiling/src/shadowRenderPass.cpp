@@ -0,0 +1,371 @@
+#include "shadowRenderPass.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <numeric>
+
+// Tetrahedron face axes, these MUST match TETRAHEDRON_FACES in shadows.glsl
+static const std::array<glm::vec3, 4> tetrahedronFaces = {
+	glm::normalize(glm::vec3( 1.0f,  1.0f,  1.0f)),
+	glm::normalize(glm::vec3(-1.0f, -1.0f,  1.0f)),
+	glm::normalize(glm::vec3(-1.0f,  1.0f, -1.0f)),
+	glm::normalize(glm::vec3( 1.0f, -1.0f, -1.0f))
+};
+
+// Each face has to reach the far corners of its spherical triangle (70.5 degrees off axis -> tan = sqrt(8)),
+// plus a little guard band for filtering. MUST match TETRAHEDRON_TAN_HALF_FOV in shadows.glsl
+constexpr float TETRAHEDRON_TAN_HALF_FOV = 2.8284271f * 1.05f;
+
+// Point lights are all that use the atlas, still never hand one the whole thing
+constexpr int MIN_TILE_LEVEL = 1;
+constexpr int MIN_TILE_DIMENSIONS = 128;
+
+// Below this much radiance a light is treated as having no influence
+constexpr float LIGHT_INFLUENCE_CUTOFF = 0.01f;
+
+// How far a light's ideal level can drift from its tile before it's moved, stops lights flickering between sizes
+constexpr float TILE_LEVEL_HYSTERESIS = 0.75f;
+constexpr int MAX_TILE_MOVES_PER_FRAME = 4;
+
+ShadowRenderPass::ShadowRenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext),
+	shadowAtlas(4096, MIN_TILE_DIMENSIONS),
+	pointShadowTiles(), tiledPointLights(), atlasRects()
+{
+	glGenFramebuffers(1, &framebuffer);
+	glGenTextures(1, &shadowAtlasTexture);
+
+	// Owned by the context so the forward pass can find it, the renderer cleans it up
+	renderContext.textures["shadowAtlas"] = shadowAtlasTexture;
+
+	cubemapShadowShader.addShader(GL_VERTEX_SHADER, "shaders/shadow_pass/shadow_pass.vert.glsl");
+	cubemapShadowShader.addShader(GL_GEOMETRY_SHADER, "shaders/shadow_pass/point_shadow_cubemap.geom.glsl");
+	cubemapShadowShader.addShader(GL_FRAGMENT_SHADER, "shaders/shadow_pass/point_shadow.frag.glsl");
+
+	tetrahedralShadowShader.addShader(GL_VERTEX_SHADER, "shaders/shadow_pass/shadow_pass.vert.glsl");
+	tetrahedralShadowShader.addShader(GL_GEOMETRY_SHADER, "shaders/shadow_pass/point_shadow_tetrahedral.geom.glsl");
+	tetrahedralShadowShader.addShader(GL_FRAGMENT_SHADER, "shaders/shadow_pass/point_shadow.frag.glsl");
+
+	paraboloidShadowShader.addShader(GL_VERTEX_SHADER, "shaders/shadow_pass/shadow_pass.vert.glsl");
+	paraboloidShadowShader.addShader(GL_GEOMETRY_SHADER, "shaders/shadow_pass/point_shadow_paraboloid.geom.glsl");
+	paraboloidShadowShader.addShader(GL_FRAGMENT_SHADER, "shaders/shadow_pass/point_shadow.frag.glsl");
+
+	resizeShadowAtlas();
+}
+
+ShadowRenderPass::~ShadowRenderPass()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+void ShadowRenderPass::setShadowAtlasDimensions(int dimensions)
+{
+	shadowAtlas.reset(dimensions);
+
+	resizeShadowAtlas();
+}
+
+void ShadowRenderPass::frame()
+{
+	PROFILE_SCOPE("ShadowRenderPass::frame");
+
+	std::vector<Light> pointLights;
+	std::vector<float> pointLightImportance;
+
+	for (const auto& light : renderContext.scene->sceneLights)
+	{
+		if (light.type == Light::LIGHT_TYPE::POINT)
+		{
+			pointLights.push_back(light);
+			pointLightImportance.push_back(getPointLightImportance(light));
+		}
+	}
+
+	syncPointLights(pointLights);
+
+	updateTiles(pointLightImportance);
+
+	renderContext.buffers.bufferData("point_shadows", sizeof(glm::vec4) * atlasRects.size(), atlasRects.data());
+
+	if (pointLights.empty()) return;
+
+	// Back faces only, keeps acne off the lit surfaces
+	glCullFace(GL_FRONT);
+
+	buildPointShadows(pointLights);
+
+	glCullFace(GL_BACK);
+
+	glViewport(0, 0, renderContext.dimensions.x, renderContext.dimensions.y);
+}
+
+void ShadowRenderPass::refresh()
+{
+	// The atlas doesn't depend on the screen size
+}
+
+void ShadowRenderPass::resizeShadowAtlas()
+{
+	// Every tile is invalid now
+	pointShadowTiles.clear();
+
+	const GLsizei dimensions = shadowAtlas.getDimensions();
+
+	glBindTexture(GL_TEXTURE_2D, shadowAtlasTexture);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, dimensions, dimensions, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_GREATER);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Depth only
+	glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, shadowAtlasTexture, 0);
+	glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+	glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+
+	if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		spdlog::critical("Failed to build shadow atlas FBO!");
+		renderContext.flags[SHADOWS_ENABLED] = false;
+	}
+}
+
+void ShadowRenderPass::syncPointLights(const std::vector<Light>& pointLights)
+{
+	const bool appended = pointLights.size() >= tiledPointLights.size() &&
+		std::equal(tiledPointLights.begin(), tiledPointLights.end(), pointLights.begin());
+
+	// A removed, edited or moved light would otherwise leave every later one on its predecessor's tile
+	if (!appended)
+	{
+		for (const auto& tile : pointShadowTiles)
+		{
+			if (tile) shadowAtlas.free(*tile);
+		}
+
+		pointShadowTiles.clear();
+	}
+
+	tiledPointLights = pointLights;
+}
+
+float ShadowRenderPass::getPointLightImportance(const Light& light) const
+{
+	// Inverse square falloff, so this is where the light drops below the cutoff
+	const glm::vec3 radiance = light.colour * light.strength;
+	const float maxRadiance = std::max({ radiance.r, radiance.g, radiance.b });
+	const float radius = std::min(std::sqrt(maxRadiance / LIGHT_INFLUENCE_CUTOFF), renderContext.farPlane);
+
+	const glm::vec3 viewPosition = renderContext.viewMatrix * glm::vec4(light.position, 1.0f);
+
+	// Entirely behind the camera
+	if (viewPosition.z > radius) return 0.0f;
+
+	const float distanceSquared = glm::dot(viewPosition, viewPosition);
+	const float radiusSquared = radius * radius;
+
+	// Camera is inside the light's influence
+	if (distanceSquared <= radiusSquared) return 1.0f;
+
+	// Projected radius of the bounding sphere in NDC, 1 = half the screen height
+	const float projectedRadius = radius * renderContext.projectionMatrix[1][1] / std::sqrt(distanceSquared - radiusSquared);
+
+	return std::clamp(projectedRadius, 0.0f, 1.0f);
+}
+
+void ShadowRenderPass::updateTiles(const std::vector<float>& importance)
+{
+	// New lights start without a tile, syncPointLights has already dealt with any others changing
+	pointShadowTiles.resize(importance.size());
+
+	const float atlasDimensions = static_cast<float>(shadowAtlas.getDimensions());
+	const float maxTileDimensions = static_cast<float>(shadowAtlas.getTileDimensions(MIN_TILE_LEVEL));
+	const int maxLevel = shadowAtlas.getNumLevels() - 1;
+
+	std::vector<float> idealLevels(importance.size());
+	for (size_t i = 0; i < importance.size(); i++)
+	{
+		const float tileDimensions = std::max(importance[i], 1e-4f) * maxTileDimensions;
+
+		idealLevels[i] = std::clamp(std::log2(atlasDimensions / tileDimensions),
+			static_cast<float>(MIN_TILE_LEVEL), static_cast<float>(maxLevel));
+	}
+
+	std::vector<size_t> order(importance.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return importance[a] > importance[b]; });
+
+	// Release the tiles that have drifted too far, most important lights get to move first
+	int moves = 0;
+	for (const size_t i : order)
+	{
+		if (moves >= MAX_TILE_MOVES_PER_FRAME) break;
+
+		auto& tile = pointShadowTiles[i];
+		if (tile && std::abs(idealLevels[i] - static_cast<float>(tile->level)) > TILE_LEVEL_HYSTERESIS)
+		{
+			shadowAtlas.free(*tile);
+			tile.reset();
+			moves++;
+		}
+	}
+
+	// Then (re)allocate, settling for smaller tiles when the atlas is full
+	for (const size_t i : order)
+	{
+		auto& tile = pointShadowTiles[i];
+		for (int level = static_cast<int>(std::round(idealLevels[i])); !tile && level <= maxLevel; level++)
+		{
+			tile = shadowAtlas.allocate(level);
+		}
+	}
+
+	const glm::ivec2 tileFaces = getTileFaces();
+
+	atlasRects.assign(importance.size(), glm::vec4(0.0f));
+	for (size_t i = 0; i < pointShadowTiles.size(); i++)
+	{
+		if (!pointShadowTiles[i]) continue; // No shadow this frame
+
+		const glm::ivec4 rect = shadowAtlas.getTileRect(*pointShadowTiles[i]);
+		const int faceDimensions = rect.z / std::max(tileFaces.x, tileFaces.y);
+
+		atlasRects[i] = glm::vec4(glm::vec2(rect.x, rect.y), glm::vec2(static_cast<float>(faceDimensions))) / atlasDimensions;
+	}
+}
+
+void ShadowRenderPass::buildPointShadows(const std::vector<Light>& pointLights)
+{
+	ScopedFramebufferBind framebufferBind(renderContext.framebufferStack, framebuffer);
+
+	glViewport(0, 0, shadowAtlas.getDimensions(), shadowAtlas.getDimensions());
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	ShaderProgram* shader = nullptr;
+	switch (renderContext.pointShadowMode)
+	{
+	case POINT_SHADOW_TETRAHEDRAL:
+		shader = &tetrahedralShadowShader;
+		break;
+	case POINT_SHADOW_DUAL_PARABOLOID:
+		shader = &paraboloidShadowShader;
+		break;
+	default:
+		shader = &cubemapShadowShader;
+		break;
+	}
+
+	shader->use();
+	renderContext.buffers.bindBuffers(*shader);
+
+	const bool isParaboloid = renderContext.pointShadowMode == POINT_SHADOW_DUAL_PARABOLOID;
+	if (isParaboloid)
+	{
+		// The back hemisphere is mirrored, which flips the winding, and everything behind each
+		// paraboloid is clipped away in the geometry shader
+		glDisable(GL_CULL_FACE);
+		glEnable(GL_CLIP_DISTANCE0);
+	}
+
+	const glm::mat4 cubemapProjection = glm::perspective(glm::radians(90.0f), 1.0f,
+		renderContext.nearPlane, renderContext.farPlane);
+
+	const glm::mat4 tetrahedronProjection = glm::perspective(2.0f * std::atan(TETRAHEDRON_TAN_HALF_FOV), 1.0f,
+		renderContext.nearPlane, renderContext.farPlane);
+
+	const glm::ivec2 tileFaces = getTileFaces();
+
+	for (size_t i = 0; i < pointLights.size(); i++)
+	{
+		if (!pointShadowTiles[i]) continue;
+
+		const glm::vec3& lightPosition = pointLights[i].position;
+
+		const glm::ivec4 rect = shadowAtlas.getTileRect(*pointShadowTiles[i]);
+		const int faceDimensions = rect.z / std::max(tileFaces.x, tileFaces.y);
+
+		// One viewport per face, the geometry shader routes each invocation to its own
+		for (int face = 0; face < tileFaces.x * tileFaces.y; face++)
+		{
+			const glm::ivec2 faceOffset = glm::ivec2(rect.x, rect.y) + glm::ivec2(face % tileFaces.x, face / tileFaces.x) * faceDimensions;
+
+			glViewportIndexedf(face,
+				static_cast<float>(faceOffset.x), static_cast<float>(faceOffset.y),
+				static_cast<float>(faceDimensions), static_cast<float>(faceDimensions));
+		}
+
+		if (renderContext.pointShadowMode == POINT_SHADOW_CUBEMAP)
+		{
+			const std::array<glm::mat4, 6> shadowTransforms = {
+				cubemapProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+				cubemapProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+				cubemapProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+				cubemapProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+				cubemapProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+				cubemapProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+			};
+
+			for (size_t j = 0; j < shadowTransforms.size(); j++)
+			{
+				shader->setMat4(std::format("uViewProjectMatrices[{}]", j), shadowTransforms[j]);
+			}
+		}
+		else if (renderContext.pointShadowMode == POINT_SHADOW_TETRAHEDRAL)
+		{
+			for (size_t j = 0; j < tetrahedronFaces.size(); j++)
+			{
+				const glm::mat4 view = glm::lookAt(lightPosition, lightPosition + tetrahedronFaces[j], glm::vec3(0.0f, 1.0f, 0.0f));
+
+				shader->setMat4(std::format("uViewProjectMatrices[{}]", j), tetrahedronProjection * view);
+			}
+		}
+
+		shader->setVec3("uLightPosition", lightPosition);
+
+		renderShadowCasters();
+	}
+
+	if (isParaboloid)
+	{
+		glDisable(GL_CLIP_DISTANCE0);
+		glEnable(GL_CULL_FACE);
+	}
+}
+
+void ShadowRenderPass::renderShadowCasters()
+{
+	for (const auto& model : renderContext.scene->sceneModels)
+	{
+		loadJoints(model);
+
+		for (const auto& prim : model->getPrimitives())
+		{
+			renderPrimitive(prim);
+		}
+	}
+}
+
+glm::ivec2 ShadowRenderPass::getTileFaces() const
+{
+	switch (renderContext.pointShadowMode)
+	{
+	case POINT_SHADOW_CUBEMAP:
+		return { 3, 2 };
+	case POINT_SHADOW_TETRAHEDRAL:
+		return { 2, 2 };
+	case POINT_SHADOW_DUAL_PARABOLOID:
+		return { 2, 1 };
+	default:
+		return { 1, 1 };
+	}
+}
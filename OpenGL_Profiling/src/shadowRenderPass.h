@@ -0,0 +1,57 @@
+#pragma once
+
+#include "renderPass.h"
+#include "shadowAtlas.h"
+
+class ShadowRenderPass : public RenderPass
+{
+public:
+	ShadowRenderPass(RenderContext& renderContext);
+	~ShadowRenderPass();
+
+	ShadowRenderPass(const ShadowRenderPass&) = delete;
+	ShadowRenderPass& operator=(const ShadowRenderPass&) = delete;
+
+public:
+	void frame() override;
+	void refresh() override;
+
+	int getShadowAtlasDimensions() const { return shadowAtlas.getDimensions(); }
+	void setShadowAtlasDimensions(int dimensions);
+
+	float getShadowAtlasUsage() const { return shadowAtlas.getUsage(); }
+
+private:
+	void resizeShadowAtlas();
+
+	// Tiles go by index, so they're all given back unless the only change to the lights is new ones on the end
+	void syncPointLights(const std::vector<Light>& pointLights);
+
+	// Hands out atlas tiles by importance, only moving a few lights per frame
+	void updateTiles(const std::vector<float>& importance);
+
+	// Roughly how much of the screen the light's influence covers, [0, 1]
+	float getPointLightImportance(const Light& light) const;
+
+	void buildPointShadows(const std::vector<Light>& pointLights);
+
+	void renderShadowCasters();
+
+	// Layout of the faces inside one point light's tile
+	glm::ivec2 getTileFaces() const;
+
+private:
+	ShadowAtlas shadowAtlas;
+
+	// One per point light, empty if there wasn't room in the atlas
+	std::vector<std::optional<ShadowAtlas::Tile>> pointShadowTiles;
+	std::vector<Light> tiledPointLights; // The lights pointShadowTiles was handed out for
+	std::vector<glm::vec4> atlasRects; // Tile offset + face size, in atlas UVs
+
+	GLuint shadowAtlasTexture;
+	GLuint framebuffer;
+
+	ShaderProgram cubemapShadowShader;
+	ShaderProgram tetrahedralShadowShader;
+	ShaderProgram paraboloidShadowShader;
+};
\ No newline at end of file
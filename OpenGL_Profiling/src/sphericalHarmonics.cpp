@@ -0,0 +1,119 @@
+#include "sphericalHarmonics.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <vector>
+
+SphericalHarmonics& SphericalHarmonics::operator+=(const SphericalHarmonics& other)
+{
+	for (size_t i = 0; i < NUM_SH_COEFFICIENTS; i++) coefficients[i] += other.coefficients[i];
+
+	return *this;
+}
+
+SphericalHarmonics& SphericalHarmonics::operator*=(float scale)
+{
+	for (auto& coefficient : coefficients) coefficient *= scale;
+
+	return *this;
+}
+
+// Real SH basis functions for bands 0 - 2
+static std::array<float, NUM_SH_COEFFICIENTS> evaluateBasis(const glm::vec3& d)
+{
+	return {
+		0.282095f,
+		0.488603f * d.y,
+		0.488603f * d.z,
+		0.488603f * d.x,
+		1.092548f * d.x * d.y,
+		1.092548f * d.y * d.z,
+		0.315392f * (3.0f * d.z * d.z - 1.0f),
+		1.092548f * d.x * d.z,
+		0.546274f * (d.x * d.x - d.y * d.y)
+	};
+}
+
+SphericalHarmonics projectEquirectangular(const float* data, int width, int height, int channels)
+{
+	const float pi = glm::pi<float>();
+
+	// Azimuth only depends on the column, worked out once rather than per texel
+	std::vector<float> cosPhi(width), sinPhi(width);
+	for (int x = 0; x < width; x++)
+	{
+		const float phi = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 0.5f) * 2.0f * pi;
+
+		cosPhi[x] = glm::cos(phi);
+		sinPhi[x] = glm::sin(phi);
+	}
+
+	std::vector<int> rows(height);
+	std::iota(rows.begin(), rows.end(), 0);
+
+	// Matches the equirectangular lookup in the cubemap shader: u = atan(z, x), v = asin(y)
+	const auto projectRow = [&](int y) {
+		const float elevation = ((static_cast<float>(y) + 0.5f) / static_cast<float>(height) - 0.5f) * pi;
+		const float cosElevation = glm::cos(elevation);
+		const float sinElevation = glm::sin(elevation);
+
+		// Texels shrink towards the poles
+		const float solidAngle = cosElevation * (pi / static_cast<float>(height)) * (2.0f * pi / static_cast<float>(width));
+
+		SphericalHarmonics row;
+
+		const float* texel = data + static_cast<size_t>(y) * width * channels;
+		for (int x = 0; x < width; x++, texel += channels)
+		{
+			const glm::vec3 direction(cosElevation * cosPhi[x], sinElevation, cosElevation * sinPhi[x]);
+			const glm::vec3 radiance(texel[0], texel[1], texel[2]);
+
+			const auto basis = evaluateBasis(direction);
+			for (size_t i = 0; i < NUM_SH_COEFFICIENTS; i++) row.coefficients[i] += radiance * basis[i];
+		}
+
+		row *= solidAngle;
+		return row;
+	};
+
+	return std::transform_reduce(std::execution::par_unseq, rows.begin(), rows.end(), SphericalHarmonics(),
+		[](SphericalHarmonics a, const SphericalHarmonics& b) { return a += b; }, projectRow);
+}
+
+SphericalHarmonics convolveIrradiance(const SphericalHarmonics& radiance)
+{
+	// Cosine lobe band factors (pi, 2pi/3, pi/4) over pi
+	constexpr std::array<float, NUM_SH_COEFFICIENTS> bandFactors = {
+		1.0f,
+		2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+		0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+	};
+
+	SphericalHarmonics irradiance;
+	for (size_t i = 0; i < NUM_SH_COEFFICIENTS; i++) irradiance.coefficients[i] = radiance.coefficients[i] * bandFactors[i];
+
+	return irradiance;
+}
+
+SphericalHarmonics projectDirectional(const glm::vec3& direction, const glm::vec3& irradiance)
+{
+	const auto basis = evaluateBasis(direction);
+
+	SphericalHarmonics sh;
+	for (size_t i = 0; i < NUM_SH_COEFFICIENTS; i++) sh.coefficients[i] = irradiance * basis[i];
+
+	return sh;
+}
+
+glm::vec3 evaluateSH(const SphericalHarmonics& sh, const glm::vec3& direction)
+{
+	const auto basis = evaluateBasis(direction);
+
+	glm::vec3 result(0.0f);
+	for (size_t i = 0; i < NUM_SH_COEFFICIENTS; i++) result += sh.coefficients[i] * basis[i];
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+
+constexpr inline size_t NUM_SH_COEFFICIENTS = 9;
+
+// Order 2 (L2) real spherical harmonics, one RGB coefficient per basis function
+struct SphericalHarmonics
+{
+	std::array<glm::vec3, NUM_SH_COEFFICIENTS> coefficients = { };
+
+	SphericalHarmonics& operator+=(const SphericalHarmonics& other);
+	SphericalHarmonics& operator*=(float scale);
+};
+
+// Projects radiance from an equirectangular image (flipped on load, row 0 at the bottom) onto SH, weighted by
+// each texel's solid angle. Rows are reduced in parallel, and are free to vectorize
+SphericalHarmonics projectEquirectangular(const float* data, int width, int height, int channels);
+
+// Radiance SH -> irradiance SH, convolved with the clamped cosine lobe and divided by pi, so evaluating it
+// gives the Lambertian diffuse lighting to multiply the albedo by
+SphericalHarmonics convolveIrradiance(const SphericalHarmonics& radiance);
+
+// A directional light, e.g. to take the emulated sun back out of the environment's SH
+SphericalHarmonics projectDirectional(const glm::vec3& direction, const glm::vec3& irradiance);
+
+glm::vec3 evaluateSH(const SphericalHarmonics& sh, const glm::vec3& direction);
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "ssaoRenderPass.h"
+
+// Weight of the current frame in the accumulation, the per frame result is only 12 samples
+constexpr float SSAO_BLEND_FACTOR = 0.1f;
+
+SSAORenderPass::SSAORenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext), halfDimensions(), aoTextures(), currentAO(0), historyValid(false),
+	frameIndex(0), radius(0.5f), strength(1.0f), quad(RenderableModel::constructUnitQuad())
+{
+	depthShader.addShader(GL_COMPUTE_SHADER, "shaders/ssao_pass/ssao_depth.comp.glsl");
+	ssaoShader.addShader(GL_COMPUTE_SHADER, "shaders/ssao_pass/ssao.comp.glsl");
+
+	compositeShader.addShader(GL_VERTEX_SHADER, "shaders/hdr_pass/hdr_pass.vert.glsl");
+	compositeShader.addShader(GL_FRAGMENT_SHADER, "shaders/ssao_pass/ssao_composite.frag.glsl");
+
+	glGenTextures(1, &depthTexture);
+	glGenTextures(static_cast<GLsizei>(aoTextures.size()), aoTextures.data());
+
+	glGenFramebuffers(1, &compositeFramebuffer);
+
+	allocateTargets();
+}
+
+SSAORenderPass::~SSAORenderPass()
+{
+	glDeleteTextures(1, &depthTexture);
+	glDeleteTextures(static_cast<GLsizei>(aoTextures.size()), aoTextures.data());
+
+	glDeleteFramebuffers(1, &compositeFramebuffer);
+}
+
+void SSAORenderPass::frame()
+{
+	PROFILE_SCOPE("SSAORenderPass::frame");
+
+	const GLuint history = aoTextures[1 - currentAO];
+	const GLuint ao = aoTextures[currentAO];
+
+	const glm::ivec2 groups = (halfDimensions + 7) / 8;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("hdrDepth"));
+
+	depthShader.use();
+	depthShader.setInt("uDepthTexture", 0);
+	depthShader.setMat4("uProjection", renderContext.projectionMatrix);
+
+	glBindImageTexture(0, depthTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+	glDispatchCompute(groups.x, groups.y, 1);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, history);
+
+	ssaoShader.use();
+	ssaoShader.setInt("uDepthTexture", 0);
+	ssaoShader.setInt("uHistoryTexture", 1);
+	ssaoShader.setFloat("uRadius", radius);
+	ssaoShader.setFloat("uBlendFactor", SSAO_BLEND_FACTOR);
+	ssaoShader.setBool("uHistoryValid", historyValid);
+	glUniform1ui(ssaoShader.getLocation("uFrameIndex"), frameIndex);
+	ssaoShader.setMat4("uProjection", renderContext.projectionMatrix);
+	ssaoShader.setMat4("uInverseView", glm::inverse(renderContext.viewMatrix));
+	ssaoShader.setMat4("uPreviousViewProjection", renderContext.previousViewProjectionMatrix);
+
+	glBindImageTexture(0, ao, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+
+	glDispatchCompute(groups.x, groups.y, 1);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	{
+		ScopedFramebufferBind framebufferBind(renderContext.framebufferStack, compositeFramebuffer);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("hdrDepth"));
+
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, ao);
+
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("hdrAmbient"));
+
+		compositeShader.use();
+		compositeShader.setInt("uDepthTexture", 0);
+		compositeShader.setInt("uAOTexture", 1);
+		compositeShader.setInt("uAmbientTexture", 2);
+		compositeShader.setFloat("uStrength", strength);
+		compositeShader.setMat4("uProjection", renderContext.projectionMatrix);
+
+		// Colour -= ambient * (1 - AO), direct light is left alone
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
+		glBlendFunc(GL_ONE, GL_ONE);
+
+		renderPrimitive(quad->getPrimitives()[0]);
+
+		glBlendEquation(GL_FUNC_ADD);
+		glDisable(GL_BLEND);
+	}
+
+	historyValid = true;
+	currentAO = 1 - currentAO;
+	frameIndex++;
+}
+
+void SSAORenderPass::refresh()
+{
+	allocateTargets();
+}
+
+void SSAORenderPass::allocateTargets()
+{
+	halfDimensions = glm::max(renderContext.dimensions / 2, glm::ivec2(1));
+
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, halfDimensions.x, halfDimensions.y, 0, GL_RED, GL_FLOAT, 0);
+
+	for (const GLuint texture : aoTextures)
+	{
+		// Linear for the reprojection, the upsample fetches texels itself
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, halfDimensions.x, halfDimensions.y, 0, GL_RG, GL_FLOAT, 0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	historyValid = false;
+
+	// The HDR pass reallocates its colour texture in place, same name
+	glNamedFramebufferTexture(compositeFramebuffer, GL_COLOR_ATTACHMENT0, renderContext.textures.at("hdrColour"), 0);
+	glNamedFramebufferDrawBuffer(compositeFramebuffer, GL_COLOR_ATTACHMENT0);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "renderPass.h"
+
+// Half resolution SSAO from the HDR pass's depth, temporally accumulated and bilaterally upsampled.
+// There's no depth prepass to run it before lighting, so afterwards the occluded share of the forward pass's
+// separate ambient target is subtracted from the HDR colour. Direct light is left alone
+class SSAORenderPass : public RenderPass
+{
+public:
+	SSAORenderPass(RenderContext& renderContext);
+	~SSAORenderPass();
+
+	SSAORenderPass(const SSAORenderPass&) = delete;
+	SSAORenderPass& operator=(const SSAORenderPass&) = delete;
+
+public:
+	void frame() override;
+	void refresh() override;
+
+	// Hemisphere radius, world units
+	float getRadius() const { return radius; }
+	void setRadius(float radius) { this->radius = radius; }
+
+	float getStrength() const { return strength; }
+	void setStrength(float strength) { this->strength = strength; }
+
+private:
+	void allocateTargets();
+
+private:
+	ShaderProgram depthShader;
+	ShaderProgram ssaoShader;
+	ShaderProgram compositeShader;
+
+	glm::ivec2 halfDimensions;
+
+	GLuint depthTexture; // Half resolution linear depth
+
+	// AO + linear depth, ping-ponged for the temporal accumulation
+	std::array<GLuint, 2> aoTextures;
+	size_t currentAO;
+	bool historyValid;
+
+	// Just the HDR colour, sampling the depth while it's attached would be a feedback loop
+	GLuint compositeFramebuffer;
+
+	uint32_t frameIndex;
+
+	float radius;
+	float strength;
+
+	const std::shared_ptr<RenderableModel> quad;
+};
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "sunExtraction.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <vector>
+
+// Width the summed-area table is built at, the search doesn't need the source's full resolution
+constexpr int ANALYSIS_WIDTH = 1024;
+
+// Half size of the search window, a few times the sun's real 0.27 degrees to catch its glow
+constexpr float SUN_WINDOW_RADIUS_DEGREES = 2.0f;
+
+// The sky around the sun is measured out to this many window radii
+constexpr int BACKGROUND_RADIUS_SCALE = 4;
+
+// How much brighter than its surroundings the window needs to be to count as a sun
+constexpr float SUN_CONTRAST = 8.0f;
+
+namespace
+{
+	float luminance(const float* rgb)
+	{
+		return 0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2];
+	}
+
+	float getElevation(int y, int height)
+	{
+		return ((static_cast<float>(y) + 0.5f) / static_cast<float>(height) - 0.5f) * glm::pi<float>();
+	}
+
+	// Summed-area table with horizontal wrapping
+	class SummedAreaTable
+	{
+	public:
+		SummedAreaTable(int width, int height) : width(width), height(height), table(static_cast<size_t>(width + 1) * (height + 1), 0.0) { }
+
+		double* row(int y) { return table.data() + static_cast<size_t>(y + 1) * (width + 1) + 1; }
+
+		void integrate()
+		{
+			// Rows are independent, then each row adds the one below it
+			std::vector<int> rows(height);
+			std::iota(rows.begin(), rows.end(), 0);
+
+			std::for_each(std::execution::par_unseq, rows.begin(), rows.end(), [this](int y) {
+				double* r = row(y);
+				std::inclusive_scan(r, r + width, r);
+			});
+
+			for (int y = 1; y < height; y++)
+			{
+				double* r = row(y);
+				const double* below = row(y - 1);
+
+				for (int x = 0; x < width; x++) r[x] += below[x];
+			}
+		}
+
+		// Inclusive, x may run off either side and wraps, y is clamped
+		double sum(int x0, int y0, int x1, int y1) const
+		{
+			y0 = std::max(y0, 0);
+			y1 = std::min(y1, height - 1);
+			if (y0 > y1) return 0.0;
+
+			if (x1 - x0 + 1 >= width) return sumUnwrapped(0, y0, width - 1, y1);
+			if (x0 < 0) return sumUnwrapped(x0 + width, y0, width - 1, y1) + sumUnwrapped(0, y0, x1, y1);
+			if (x1 >= width) return sumUnwrapped(x0, y0, width - 1, y1) + sumUnwrapped(0, y0, x1 - width, y1);
+
+			return sumUnwrapped(x0, y0, x1, y1);
+		}
+
+	private:
+		double at(int x, int y) const { return table[static_cast<size_t>(y + 1) * (width + 1) + (x + 1)]; }
+
+		double sumUnwrapped(int x0, int y0, int x1, int y1) const
+		{
+			return at(x1, y1) - at(x0 - 1, y1) - at(x1, y0 - 1) + at(x0 - 1, y0 - 1);
+		}
+
+		int width, height;
+		std::vector<double> table;
+	};
+}
+
+SunEstimate estimateSun(const float* data, int width, int height, int channels)
+{
+	const float pi = glm::pi<float>();
+
+	// Downsampled by whole pixels, so each analysis texel is an exact block of the source
+	const int factor = std::max(width / ANALYSIS_WIDTH, 1);
+	const int analysisWidth = width / factor;
+	const int analysisHeight = std::max(height / factor, 1);
+
+	// Luminance * solid angle, and the solid angle of one analysis texel in each row
+	SummedAreaTable radiance(analysisWidth, analysisHeight);
+	std::vector<double> rowSolidAngle(analysisHeight);
+
+	std::vector<int> rows(analysisHeight);
+	std::iota(rows.begin(), rows.end(), 0);
+
+	std::for_each(std::execution::par_unseq, rows.begin(), rows.end(), [&](int ay) {
+		double* out = radiance.row(ay);
+
+		double solidAngle = 0.0;
+		for (int y = ay * factor; y < std::min((ay + 1) * factor, height); y++)
+		{
+			// Texels shrink towards the poles
+			const float texelSolidAngle = glm::cos(getElevation(y, height)) * (pi / height) * (2.0f * pi / width);
+			solidAngle += texelSolidAngle;
+
+			const float* pixel = data + static_cast<size_t>(y) * width * channels;
+			for (int x = 0; x < analysisWidth * factor; x++, pixel += channels)
+			{
+				out[x / factor] += luminance(pixel) * texelSolidAngle;
+			}
+		}
+
+		// A texel covers factor source columns as well as factor rows
+		rowSolidAngle[ay] = solidAngle * factor;
+	});
+
+	radiance.integrate();
+
+	std::vector<double> solidAnglePrefix(analysisHeight + 1, 0.0);
+	std::inclusive_scan(rowSolidAngle.begin(), rowSolidAngle.end(), solidAnglePrefix.begin() + 1);
+
+	// Average radiance of a window, by solid angle rather than pixel count
+	const auto windowAverage = [&](int x, int y, int radius) {
+		const int y0 = std::max(y - radius, 0), y1 = std::min(y + radius, analysisHeight - 1);
+		const int columns = std::min(2 * radius + 1, analysisWidth);
+
+		const double solidAngle = (solidAnglePrefix[y1 + 1] - solidAnglePrefix[y0]) * columns;
+		return std::make_pair(radiance.sum(x - radius, y0, x + radius, y1), solidAngle);
+	};
+
+	const int windowRadius = std::max(static_cast<int>(std::round(SUN_WINDOW_RADIUS_DEGREES / 360.0f * analysisWidth)), 1);
+
+	// Brightest window, every analysis texel's window is O(1) from the table
+	struct Peak { double average; int x, y; };
+
+	const Peak peak = std::transform_reduce(std::execution::par_unseq, rows.begin(), rows.end(), Peak{ -1.0, 0, 0 },
+		[](const Peak& a, const Peak& b) { return a.average >= b.average ? a : b; },
+		[&](int y) {
+			Peak best = { -1.0, 0, y };
+			for (int x = 0; x < analysisWidth; x++)
+			{
+				const auto [sum, solidAngle] = windowAverage(x, y, windowRadius);
+				const double average = sum / solidAngle;
+
+				if (average > best.average) best = { average, x, y };
+			}
+			return best;
+		});
+
+	// Surrounding sky, excluding the window itself
+	const auto [outerSum, outerSolidAngle] = windowAverage(peak.x, peak.y, windowRadius * BACKGROUND_RADIUS_SCALE);
+	const auto [innerSum, innerSolidAngle] = windowAverage(peak.x, peak.y, windowRadius);
+	const double background = (outerSum - innerSum) / std::max(outerSolidAngle - innerSolidAngle, 1e-12);
+
+	SunEstimate sun = { false, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f) };
+	if (peak.average < SUN_CONTRAST * background || peak.average <= 0.0) return sun;
+
+	// Back at full resolution, only the window's pixels are visited
+	const int x0 = (peak.x - windowRadius) * factor, x1 = (peak.x + windowRadius + 1) * factor - 1;
+	const int y0 = std::max((peak.y - windowRadius) * factor, 0), y1 = std::min((peak.y + windowRadius + 1) * factor - 1, height - 1);
+
+	glm::vec3 weightedDirection(0.0f);
+	for (int y = y0; y <= y1; y++)
+	{
+		const float elevation = getElevation(y, height);
+		const float texelSolidAngle = glm::cos(elevation) * (pi / height) * (2.0f * pi / width);
+
+		for (int wrappedX = x0; wrappedX <= x1; wrappedX++)
+		{
+			const int x = (wrappedX % width + width) % width;
+			const float* pixel = data + (static_cast<size_t>(y) * width + x) * channels;
+
+			// Only what's above the sky's level, keeping the pixel's colour
+			const float pixelLuminance = luminance(pixel);
+			const float excess = std::max(pixelLuminance - static_cast<float>(background), 0.0f);
+			if (excess <= 0.0f) continue;
+
+			const glm::vec3 rgb(pixel[0], pixel[1], pixel[2]);
+			sun.irradiance += rgb * (excess / pixelLuminance) * texelSolidAngle;
+
+			const float phi = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 0.5f) * 2.0f * pi;
+			const glm::vec3 direction(glm::cos(elevation) * glm::cos(phi), glm::sin(elevation), glm::cos(elevation) * glm::sin(phi));
+
+			weightedDirection += direction * excess * texelSolidAngle;
+		}
+	}
+
+	if (glm::length(weightedDirection) <= 0.0f) return sun;
+
+	sun.found = true;
+	sun.direction = glm::normalize(weightedDirection);
+
+	return sun;
+}
\ No newline at end of file
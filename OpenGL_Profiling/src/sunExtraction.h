@@ -0,0 +1,17 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The sun found in an environment map, to emulate as a directional light
+struct SunEstimate
+{
+	bool found; // False for overcast / sunless skies
+
+	glm::vec3 direction; // Towards the sun
+	glm::vec3 irradiance; // Radiance above the surrounding sky, integrated over the sun's solid angle
+};
+
+// Finds the brightest sun sized window of an equirectangular image (flipped on load, row 0 at the bottom),
+// using a summed-area table of solid angle weighted luminance at reduced resolution, then integrates the
+// pixels in it above the surrounding sky's level. Rows are processed in parallel
+SunEstimate estimateSun(const float* data, int width, int height, int channels);
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "taaRenderPass.h"
+
+constexpr uint32_t NUM_JITTER_PHASES = 8;
+constexpr uint32_t MAX_JITTER_PHASES = 32;
+
+// Low discrepancy, consecutive frames cover the pixel evenly
+static float halton(uint32_t index, uint32_t base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+
+	while (index > 0)
+	{
+		fraction /= static_cast<float>(base);
+		result += fraction * static_cast<float>(index % base);
+		index /= base;
+	}
+
+	return result;
+}
+
+TAARenderPass::TAARenderPass(RenderContext& renderContext)
+	: RenderPass(renderContext), historyTextures(), currentHistory(0), historyValid(false),
+	resolveDimensions(), frameIndex(0), temporalUpsampling(false), blendFactor(0.1f)
+{
+	resolveShader.addShader(GL_COMPUTE_SHADER, "shaders/taa_pass/taa_resolve.comp.glsl");
+
+	glGenTextures(static_cast<GLsizei>(historyTextures.size()), historyTextures.data());
+
+	allocateHistory();
+}
+
+TAARenderPass::~TAARenderPass()
+{
+	glDeleteTextures(static_cast<GLsizei>(historyTextures.size()), historyTextures.data());
+}
+
+void TAARenderPass::frame()
+{
+	PROFILE_SCOPE("TAARenderPass::frame");
+
+	const GLuint history = historyTextures[1 - currentHistory];
+	const GLuint resolved = historyTextures[currentHistory];
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("hdrColour"));
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, renderContext.textures.at("velocity"));
+
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, history);
+
+	glActiveTexture(GL_TEXTURE0);
+
+	resolveShader.use();
+	resolveShader.setInt("uCurrentTexture", 0);
+	resolveShader.setInt("uVelocityTexture", 1);
+	resolveShader.setInt("uHistoryTexture", 2);
+	resolveShader.setVec2("uJitter", renderContext.jitter);
+	resolveShader.setFloat("uBlendFactor", blendFactor);
+	resolveShader.setBool("uHistoryValid", historyValid);
+
+	glBindImageTexture(0, resolved, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+	glDispatchCompute((resolveDimensions.x + 7) / 8, (resolveDimensions.y + 7) / 8, 1);
+
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// Everything after this reads the resolve instead of the raw HDR target
+	renderContext.sceneColour = resolved;
+	renderContext.sceneColourDimensions = resolveDimensions;
+
+	historyValid = true;
+	currentHistory = 1 - currentHistory;
+	frameIndex++;
+}
+
+void TAARenderPass::refresh()
+{
+	// Upsampling to a window that didn't change, the render scale moving doesn't invalidate the history
+	if (temporalUpsampling && resolveDimensions == renderContext.outputDimensions) return;
+
+	allocateHistory();
+}
+
+glm::vec2 TAARenderPass::getJitter() const
+{
+	// Halton starts at 1, index 0 would be the unjittered centre every time round
+	const uint32_t phase = frameIndex % getNumJitterPhases() + 1;
+
+	return glm::vec2(halton(phase, 2), halton(phase, 3)) - 0.5f;
+}
+
+void TAARenderPass::setTemporalUpsampling(bool temporalUpsampling)
+{
+	this->temporalUpsampling = temporalUpsampling;
+
+	allocateHistory();
+}
+
+void TAARenderPass::allocateHistory()
+{
+	resolveDimensions = temporalUpsampling ? renderContext.outputDimensions : renderContext.dimensions;
+
+	for (const GLuint texture : historyTextures)
+	{
+		// Linear for the reprojection, which lands between texels
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, resolveDimensions.x, resolveDimensions.y, 0, GL_RGBA, GL_FLOAT, 0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	historyValid = false;
+}
+
+uint32_t TAARenderPass::getNumJitterPhases() const
+{
+	const glm::vec2 ratio = glm::vec2(resolveDimensions) / glm::vec2(glm::max(renderContext.dimensions, glm::ivec2(1)));
+
+	const uint32_t phases = static_cast<uint32_t>(glm::ceil(static_cast<float>(NUM_JITTER_PHASES) * ratio.x * ratio.y));
+
+	return glm::clamp(phases, NUM_JITTER_PHASES, MAX_JITTER_PHASES);
+}
\ No newline at end of file
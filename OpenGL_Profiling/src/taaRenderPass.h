@@ -0,0 +1,54 @@
+#pragma once
+
+#include "renderPass.h"
+
+// Temporal AA over the HDR target. The renderer jitters the projection by getJitter() every frame and the forward
+// pass writes motion vectors, the resolve accumulates them into a history at render or window size
+class TAARenderPass : public RenderPass
+{
+public:
+	TAARenderPass(RenderContext& renderContext);
+	~TAARenderPass();
+
+	TAARenderPass(const TAARenderPass&) = delete;
+	TAARenderPass& operator=(const TAARenderPass&) = delete;
+
+public:
+	// Resolves the HDR target into the history, which then becomes the context's scene colour
+	void frame() override;
+	void refresh() override;
+
+	// Sub-pixel offset for this frame in render pixels, [-0.5, 0.5]
+	glm::vec2 getJitter() const;
+
+	// Resolve at window size rather than render size, the jitter fills in the missing detail over a few frames
+	bool getTemporalUpsampling() const { return temporalUpsampling; }
+	void setTemporalUpsampling(bool temporalUpsampling);
+
+	// Weight of the current frame, lower is smoother but slower to react
+	float getBlendFactor() const { return blendFactor; }
+	void setBlendFactor(float blendFactor) { this->blendFactor = blendFactor; }
+
+	glm::ivec2 getResolveDimensions() const { return resolveDimensions; }
+
+private:
+	void allocateHistory();
+
+	// More phases when upsampling, so every output pixel gets sampled
+	uint32_t getNumJitterPhases() const;
+
+private:
+	ShaderProgram resolveShader;
+
+	// Ping-pong, one is read as last frame's history while the other is written
+	std::array<GLuint, 2> historyTextures;
+	size_t currentHistory;
+	bool historyValid;
+
+	glm::ivec2 resolveDimensions;
+
+	uint32_t frameIndex;
+
+	bool temporalUpsampling;
+	float blendFactor;
+};
\ No newline at end of file
@@ -0,0 +1,424 @@
+#include "textureCache.h"
+
+#include <spdlog/spdlog.h>
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct KTX2Header
+	{
+		std::array<uint8_t, 12> identifier;
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct KTX2Level
+	{
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(KTX2Header) == 80 && sizeof(KTX2Level) == 24);
+
+	struct FormatDesc
+	{
+		GLenum internalFormat;
+		GLenum format;
+		uint32_t vkFormat;
+		uint32_t channels; // All half floats
+	};
+
+	constexpr std::array<FormatDesc, 2> SUPPORTED_FORMATS = { {
+		{ GL_RGBA16F, GL_RGBA, 97, 4 }, // VK_FORMAT_R16G16B16A16_SFLOAT
+		{ GL_RG16F, GL_RG, 83, 2 }		// VK_FORMAT_R16G16_SFLOAT
+	} };
+
+	const FormatDesc* findFormat(GLenum internalFormat)
+	{
+		for (const auto& format : SUPPORTED_FORMATS)
+		{
+			if (format.internalFormat == internalFormat) return &format;
+		}
+
+		return nullptr;
+	}
+
+	template<typename T>
+	void append(std::vector<uint8_t>& bytes, const T& value)
+	{
+		const auto* data = reinterpret_cast<const uint8_t*>(&value);
+		bytes.insert(bytes.end(), data, data + sizeof(T));
+	}
+
+	void pad(std::vector<uint8_t>& bytes, size_t alignment)
+	{
+		bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+	}
+
+	// Basic data format descriptor, linear RGBSDA half float channels
+	std::vector<uint8_t> buildDFD(const FormatDesc& format)
+	{
+		constexpr std::array<uint8_t, 4> CHANNEL_IDS = { 0, 1, 2, 15 }; // R G B A
+
+		const uint32_t blockSize = 24 + 16 * format.channels;
+
+		std::vector<uint8_t> dfd;
+		append(dfd, 4 + blockSize); // Total size
+		append(dfd, uint32_t(0)); // Khronos vendor, basic descriptor type
+		append(dfd, uint32_t(2 | (blockSize << 16))); // Version 2
+		append(dfd, std::array<uint8_t, 4>{ 1, 1, 1, 0 }); // RGBSDA, BT709, linear, straight alpha
+		append(dfd, std::array<uint8_t, 4>{ 0, 0, 0, 0 }); // 1x1x1x1 texel blocks
+		append(dfd, std::array<uint8_t, 8>{ static_cast<uint8_t>(format.channels * 2), 0, 0, 0, 0, 0, 0, 0 });
+
+		for (uint32_t i = 0; i < format.channels; i++)
+		{
+			append(dfd, static_cast<uint16_t>(i * 16)); // Bit offset
+			append(dfd, uint8_t(15)); // Bit length - 1
+			append(dfd, static_cast<uint8_t>(0xC0 | CHANNEL_IDS[i])); // Float, signed
+			append(dfd, uint32_t(0)); // Sample position
+			append(dfd, uint32_t(0xBF800000)); // -1.0f
+			append(dfd, uint32_t(0x3F800000)); // 1.0f
+		}
+
+		return dfd;
+	}
+}
+
+bool writeKTX2(const std::filesystem::path& path, const KTXImage& image)
+{
+	const FormatDesc* format = findFormat(image.internalFormat);
+	if (!format || (image.target != GL_TEXTURE_2D && image.target != GL_TEXTURE_CUBE_MAP))
+	{
+		spdlog::error("Unsupported KTX2 texture format: {}", path.string());
+		return false;
+	}
+
+	const uint32_t levels = static_cast<uint32_t>(image.levels.size());
+	const uint32_t texelSize = format->channels * 2;
+
+	KTX2Header header = { };
+	header.identifier = KTX2_IDENTIFIER;
+	header.vkFormat = format->vkFormat;
+	header.typeSize = 2;
+	header.pixelWidth = static_cast<uint32_t>(image.dimensions.x);
+	header.pixelHeight = static_cast<uint32_t>(image.dimensions.y);
+	header.faceCount = image.target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	header.levelCount = levels;
+
+	const std::vector<uint8_t> dfd = buildDFD(*format);
+
+	std::vector<uint8_t> kvd;
+	for (const auto& [key, value] : image.metadata)
+	{
+		append(kvd, static_cast<uint32_t>(key.size() + 1 + value.size()));
+		kvd.insert(kvd.end(), key.begin(), key.end());
+		kvd.push_back(0);
+		kvd.insert(kvd.end(), value.begin(), value.end());
+		pad(kvd, 4);
+	}
+
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(KTX2Header) + sizeof(KTX2Level) * levels);
+	header.dfdByteLength = static_cast<uint32_t>(dfd.size());
+	header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+	header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+	std::vector<uint8_t> bytes;
+	append(bytes, header);
+	bytes.resize(header.dfdByteOffset); // Level index, filled in below
+	bytes.insert(bytes.end(), dfd.begin(), dfd.end());
+	bytes.insert(bytes.end(), kvd.begin(), kvd.end());
+
+	// Mips are stored smallest first
+	std::vector<KTX2Level> levelIndex(levels);
+	for (uint32_t level = levels; level-- > 0; )
+	{
+		pad(bytes, texelSize);
+
+		levelIndex[level] = { bytes.size(), image.levels[level].size(), image.levels[level].size() };
+
+		bytes.insert(bytes.end(), image.levels[level].begin(), image.levels[level].end());
+	}
+
+	std::memcpy(bytes.data() + sizeof(KTX2Header), levelIndex.data(), sizeof(KTX2Level) * levels);
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+	{
+		spdlog::warn("Failed to write texture cache: {}", path.string());
+		return false;
+	}
+
+	return true;
+}
+
+std::optional<KTXImage> readKTX2(const std::filesystem::path& path, GLenum target, GLenum internalFormat)
+{
+	const FormatDesc* format = findFormat(internalFormat);
+	if (!format) return std::nullopt;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return std::nullopt;
+
+	const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	KTX2Header header;
+	if (bytes.size() < sizeof(KTX2Header)) return std::nullopt;
+	std::memcpy(&header, bytes.data(), sizeof(KTX2Header));
+
+	const uint32_t faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+
+	if (header.identifier != KTX2_IDENTIFIER || header.vkFormat != format->vkFormat || header.faceCount != faces ||
+		header.pixelDepth != 0 || header.layerCount != 0 || header.supercompressionScheme != 0 ||
+		header.levelCount == 0 || header.levelCount > 32 || header.pixelWidth == 0 || header.pixelHeight == 0)
+	{
+		spdlog::warn("Ignoring unexpected KTX2 file: {}", path.string());
+		return std::nullopt;
+	}
+
+	const size_t levelIndexEnd = sizeof(KTX2Header) + sizeof(KTX2Level) * header.levelCount;
+	const size_t kvdEnd = static_cast<size_t>(header.kvdByteOffset) + header.kvdByteLength;
+	if (bytes.size() < levelIndexEnd || bytes.size() < kvdEnd) return std::nullopt;
+
+	std::vector<KTX2Level> levelIndex(header.levelCount);
+	std::memcpy(levelIndex.data(), bytes.data() + sizeof(KTX2Header), sizeof(KTX2Level) * header.levelCount);
+
+	KTXImage image = { target, internalFormat, glm::ivec2(header.pixelWidth, header.pixelHeight), { }, { } };
+
+	const uint32_t texelSize = format->channels * 2;
+	for (uint32_t level = 0; level < header.levelCount; level++)
+	{
+		const uint64_t levelWidth = std::max(header.pixelWidth >> level, 1u);
+		const uint64_t levelHeight = std::max(header.pixelHeight >> level, 1u);
+
+		// Subtracted rather than summed, so a garbage offset can't wrap around past the check
+		if (levelIndex[level].byteLength != levelWidth * levelHeight * texelSize * faces ||
+			levelIndex[level].byteOffset > bytes.size() || levelIndex[level].byteLength > bytes.size() - levelIndex[level].byteOffset)
+		{
+			spdlog::warn("Truncated KTX2 file: {}", path.string());
+			return std::nullopt;
+		}
+
+		const auto levelStart = bytes.begin() + levelIndex[level].byteOffset;
+		image.levels.emplace_back(levelStart, levelStart + levelIndex[level].byteLength);
+	}
+
+	for (size_t offset = header.kvdByteOffset; offset + 4 <= kvdEnd; )
+	{
+		uint32_t length;
+		std::memcpy(&length, bytes.data() + offset, 4);
+		offset += 4;
+
+		// A length running off the end means the file's corrupt, so it gets prefiltered again
+		if (length > kvdEnd - offset)
+		{
+			spdlog::warn("Truncated KTX2 file: {}", path.string());
+			return std::nullopt;
+		}
+
+		const std::string entry(reinterpret_cast<const char*>(bytes.data() + offset), length);
+		const size_t separator = entry.find('\0');
+		if (separator != std::string::npos)
+		{
+			image.metadata[entry.substr(0, separator)] = entry.substr(separator + 1);
+		}
+
+		offset = (offset + length + 3) / 4 * 4;
+	}
+
+	return image;
+}
+
+namespace
+{
+	// Every level of the texture sized for its data, which is left zeroed
+	KTXImage allocateLevels(GLuint texture, GLenum target, GLenum internalFormat)
+	{
+		const FormatDesc* format = findFormat(internalFormat);
+		assert(format);
+
+		GLint width, height, levels;
+		glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+		glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+
+		KTXImage image = { target, internalFormat, glm::ivec2(width, height), { }, { } };
+
+		const size_t faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+		for (GLint level = 0; level < levels; level++)
+		{
+			const size_t levelWidth = std::max(width >> level, 1);
+			const size_t levelHeight = std::max(height >> level, 1);
+
+			image.levels.emplace_back(levelWidth * levelHeight * format->channels * 2 * faces);
+		}
+
+		return image;
+	}
+}
+
+KTXImage downloadTexture(GLuint texture, GLenum target, GLenum internalFormat)
+{
+	KTXImage image = allocateLevels(texture, target, internalFormat);
+	const FormatDesc* format = findFormat(internalFormat);
+
+	for (size_t level = 0; level < image.levels.size(); level++)
+	{
+		auto& data = image.levels[level];
+
+		// All six faces at once for cube maps
+		glGetTextureImage(texture, static_cast<GLint>(level), format->format, GL_HALF_FLOAT, static_cast<GLsizei>(data.size()), data.data());
+	}
+
+	return image;
+}
+
+PendingDownload beginDownloadTexture(GLuint texture, GLenum target, GLenum internalFormat)
+{
+	PendingDownload download = { allocateLevels(texture, target, internalFormat), 0, nullptr };
+	const FormatDesc* format = findFormat(internalFormat);
+
+	size_t bytes = 0;
+	for (const auto& data : download.image.levels) bytes += data.size();
+
+	glCreateBuffers(1, &download.buffer);
+	glNamedBufferStorage(download.buffer, static_cast<GLsizeiptr>(bytes), nullptr, GL_CLIENT_STORAGE_BIT);
+
+	// With a pack buffer bound the pointer is an offset into it, and the copies are queued rather than waited on
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, download.buffer);
+
+	size_t offset = 0;
+	for (size_t level = 0; level < download.image.levels.size(); level++)
+	{
+		const size_t size = download.image.levels[level].size();
+
+		glGetTextureImage(texture, static_cast<GLint>(level), format->format, GL_HALF_FLOAT, static_cast<GLsizei>(size),
+			reinterpret_cast<void*>(offset));
+
+		offset += size;
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	download.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	return download;
+}
+
+bool finishDownloadTexture(PendingDownload& download)
+{
+	if (glClientWaitSync(download.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return false;
+
+	size_t offset = 0;
+	for (auto& data : download.image.levels)
+	{
+		glGetNamedBufferSubData(download.buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(data.size()), data.data());
+		offset += data.size();
+	}
+
+	releaseDownloadTexture(download);
+
+	return true;
+}
+
+void releaseDownloadTexture(PendingDownload& download)
+{
+	glDeleteBuffers(1, &download.buffer);
+	glDeleteSync(download.fence);
+
+	download.buffer = 0;
+	download.fence = nullptr;
+}
+
+GLuint uploadTexture(const KTXImage& image)
+{
+	const FormatDesc* format = findFormat(image.internalFormat);
+	assert(format);
+
+	GLuint texture;
+	glCreateTextures(image.target, 1, &texture);
+	glTextureStorage2D(texture, static_cast<GLsizei>(image.levels.size()), image.internalFormat, image.dimensions.x, image.dimensions.y);
+
+	for (size_t level = 0; level < image.levels.size(); level++)
+	{
+		const GLint mip = static_cast<GLint>(level);
+		const GLsizei levelWidth = std::max(image.dimensions.x >> mip, 1);
+		const GLsizei levelHeight = std::max(image.dimensions.y >> mip, 1);
+
+		// Cube maps take all six faces as layers
+		if (image.target == GL_TEXTURE_CUBE_MAP)
+		{
+			glTextureSubImage3D(texture, mip, 0, 0, 0, levelWidth, levelHeight, 6, format->format, GL_HALF_FLOAT, image.levels[level].data());
+		}
+		else
+		{
+			glTextureSubImage2D(texture, mip, 0, 0, levelWidth, levelHeight, format->format, GL_HALF_FLOAT, image.levels[level].data());
+		}
+	}
+
+	return texture;
+}
+
+bool saveTextureKTX2(const std::filesystem::path& path, GLuint texture, GLenum target, GLenum internalFormat, const KTXMetadata& metadata)
+{
+	if (!findFormat(internalFormat))
+	{
+		spdlog::error("Unsupported KTX2 texture format: {}", path.string());
+		return false;
+	}
+
+	KTXImage image = downloadTexture(texture, target, internalFormat);
+	image.metadata = metadata;
+
+	return writeKTX2(path, image);
+}
+
+GLuint loadTextureKTX2(const std::filesystem::path& path, GLenum target, GLenum internalFormat, KTXMetadata& metadata)
+{
+	const std::optional<KTXImage> image = readKTX2(path, target, internalFormat);
+	if (!image) return 0;
+
+	metadata = image->metadata;
+
+	return uploadTexture(*image);
+}
+
+uint64_t hashFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return 0;
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+
+	std::vector<char> buffer(1 << 20);
+	while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0)
+	{
+		for (std::streamsize i = 0; i < file.gcount(); i++)
+		{
+			hash = (hash ^ static_cast<uint8_t>(buffer[i])) * 0x100000001B3ull;
+		}
+	}
+
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Key / value data stored alongside the texture, e.g. the cache key it was generated for
+using KTXMetadata = std::map<std::string, std::string>;
+
+// CPU copy of every mip (and face) of a texture, what goes in and out of the KTX2 files
+struct KTXImage
+{
+	GLenum target; // GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+	GLenum internalFormat; // GL_RGBA16F or GL_RG16F
+	glm::ivec2 dimensions;
+	std::vector<std::vector<uint8_t>> levels; // Half floats, cube map faces consecutive
+	KTXMetadata metadata;
+};
+
+// Uncompressed KTX2 files, for caching expensive to generate textures on disk.
+// Reading and writing the files makes no GL calls, so it can happen on a worker thread
+
+bool writeKTX2(const std::filesystem::path& path, const KTXImage& image);
+
+// Nothing if the file is missing, corrupt, or doesn't hold a target / internalFormat texture
+std::optional<KTXImage> readKTX2(const std::filesystem::path& path, GLenum target, GLenum internalFormat);
+
+// Reads back all the levels of an immutable texture, stalls until the GPU has finished with it
+KTXImage downloadTexture(GLuint texture, GLenum target, GLenum internalFormat);
+
+// downloadTexture without the stall, the levels are copied into a pixel pack buffer behind a fence
+struct PendingDownload
+{
+	KTXImage image; // Levels sized, only filled in once finished
+	GLuint buffer;
+	GLsync fence;
+};
+
+PendingDownload beginDownloadTexture(GLuint texture, GLenum target, GLenum internalFormat);
+
+// Never waits. Once the GPU is done: fills in the image, frees the buffer and fence and returns true
+bool finishDownloadTexture(PendingDownload& download);
+
+// Frees the buffer and fence of a download that won't be finished
+void releaseDownloadTexture(PendingDownload& download);
+
+// Creates a new immutable texture
+GLuint uploadTexture(const KTXImage& image);
+
+// Both halves at once, on the GL thread
+bool saveTextureKTX2(const std::filesystem::path& path, GLuint texture, GLenum target, GLenum internalFormat, const KTXMetadata& metadata);
+
+// 0 if readKTX2 would have returned nothing
+GLuint loadTextureKTX2(const std::filesystem::path& path, GLenum target, GLenum internalFormat, KTXMetadata& metadata);
+
+// FNV-1a of the file's contents, 0 if it can't be read
+uint64_t hashFile(const std::filesystem::path& path);
\ No newline at end of file